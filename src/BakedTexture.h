@@ -0,0 +1,284 @@
+#ifndef BAKED_TEXTURE_H
+#define BAKED_TEXTURE_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Texture.h"
+#include "MappedFile.h"
+#include "GLState.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Baked texture container (.btex): final GL format and the full mip chain, uploaded straight from a
+// memory mapping without any image decoding at runtime.
+//
+// layout: BakedTextureHeader, BakedTextureLevel[levels], level data (each level 16 byte aligned)
+struct BakedTextureHeader
+{
+	char magic[4];			// "BTEX"
+	uint32_t version;
+	uint32_t width, height;
+	uint32_t levels;
+	uint32_t internalFormat;	// glTexImage2D internalformat
+	uint32_t format;			// glTexImage2D format
+	uint32_t type;				// glTexImage2D type
+};
+
+struct BakedTextureLevel
+{
+	uint64_t offset;	// from the start of the file
+	uint64_t size;
+	uint32_t width, height;
+};
+
+class BakedTexture
+{
+public:
+	static const uint32_t VERSION = 1;
+
+	// map the file and validate the header and level table
+	bool open(const std::string &path)
+	{
+		if (!file.open(path))
+			return false;
+		if (file.size() < sizeof(BakedTextureHeader))
+			return fail(path, "truncated header");
+
+		header = (const BakedTextureHeader *)file.data();
+		if (std::memcmp(header->magic, "BTEX", 4) != 0 || header->version != VERSION)
+			return fail(path, "not a baked texture or wrong version");
+		if (header->levels == 0 || sizeof(BakedTextureHeader) + header->levels * sizeof(BakedTextureLevel) > file.size())
+			return fail(path, "truncated level table");
+
+		// dimensions beyond any GL texture size limit would also overflow the size math below
+		uint64_t texelBytes = bytesPerTexel(header->format, header->type);
+		if (texelBytes == 0)
+			return fail(path, "unsupported format");
+		if (header->width == 0 || header->height == 0 || header->width > MAX_SIZE || header->height > MAX_SIZE)
+			return fail(path, "bad dimensions");
+		uint32_t maxLevels = 1;
+		while ((std::max(header->width, header->height) >> maxLevels) > 0)
+			maxLevels++;
+		if (header->levels > maxLevels)
+			return fail(path, "more levels than the mip chain has");
+
+		levelTable = (const BakedTextureLevel *)(file.data() + sizeof(BakedTextureHeader));
+		for (uint32_t i = 0; i < header->levels; i++)
+		{
+			const BakedTextureLevel &level = levelTable[i];
+			if (level.width != std::max(1u, header->width >> i) || level.height != std::max(1u, header->height >> i))
+				return fail(path, "level dimensions do not follow the mip chain");
+			if (level.size != (uint64_t)level.width * level.height * texelBytes)
+				return fail(path, "level size does not match its dimensions");
+			// written so it can't wrap around
+			if (level.size > file.size() || level.offset > file.size() - level.size)
+				return fail(path, "level data out of bounds");
+		}
+		return true;
+	}
+
+	// start paging the file in, meant for a loader thread ahead of upload()
+	void prefetch() const
+	{
+		file.prefetch();
+	}
+
+	// upload every mip level into an existing texture object, render thread only
+	void upload(unsigned int textureID) const
+	{
+		GLState::get().bindTexture(GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levels - 1);
+		for (uint32_t i = 0; i < header->levels; i++)
+		{
+			const BakedTextureLevel &level = levelTable[i];
+			glTexImage2D(GL_TEXTURE_2D, i, header->internalFormat, level.width, level.height, 0, header->format, header->type, file.data() + level.offset);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	const BakedTextureHeader &info() const { return *header; }
+
+	// pixels of one mip level, rows tightly packed
+	const unsigned char *levelData(uint32_t level) const { return file.data() + levelTable[level].offset; }
+	const BakedTextureLevel &level(uint32_t level) const { return levelTable[level]; }
+
+	// components per texel for 8 bit formats, 0 for anything else
+	int channels() const
+	{
+		if (header->type != GL_UNSIGNED_BYTE)
+			return 0;
+		switch (header->format)
+		{
+		case GL_RED:
+			return 1;
+		case GL_RG:
+			return 2;
+		case GL_RGB:
+			return 3;
+		case GL_RGBA:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+private:
+	static const uint32_t MAX_SIZE = 1 << 16;
+
+	MappedFile file;
+	const BakedTextureHeader *header = NULL;
+	const BakedTextureLevel *levelTable = NULL;
+
+	// tightly packed bytes per texel, 0 for combinations upload() doesn't know
+	static uint64_t bytesPerTexel(uint32_t format, uint32_t type)
+	{
+		uint64_t components;
+		switch (format)
+		{
+		case GL_RED:
+			components = 1;
+			break;
+		case GL_RG:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+			components = 3;
+			break;
+		case GL_RGBA:
+		case GL_BGRA:
+			components = 4;
+			break;
+		default:
+			return 0;
+		}
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+			return components;
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return components * 2;
+		case GL_FLOAT:
+			return components * 4;
+		default:
+			return 0;
+		}
+	}
+
+	bool fail(const std::string &path, const char *reason)
+	{
+		spdlog::error("Invalid baked texture {}: {}", path, reason);
+		file.close();
+		header = NULL;
+		levelTable = NULL;
+		return false;
+	}
+};
+
+// baked file sitting next to a source image: assets/dog.jpeg -> assets/dog.btex
+inline std::string bakedTexturePath(const std::string &imagePath)
+{
+	return std::filesystem::path(imagePath).replace_extension(".btex").string();
+}
+
+// offline step: decode an image, build the mip chain with a 2x2 box filter and write a .btex
+inline bool bakeTexture(const std::string &inputPath, const std::string &outputPath)
+{
+	static const GLenum formats[5] = {0, GL_RED, GL_RG, GL_RGB, GL_RGBA};
+	static const GLenum internalFormats[5] = {0, GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+
+	stbi_set_flip_vertically_on_load_thread(true); // match Texture
+	int width, height, channels;
+	unsigned char *pixels = stbi_load(inputPath.c_str(), &width, &height, &channels, 0);
+	if (!pixels)
+	{
+		spdlog::error("Failed to load texture file {}: {}", inputPath, stbi_failure_reason());
+		return false;
+	}
+
+	// full mip chain down to 1x1, odd sizes clamp the second sample to the edge
+	std::vector<std::vector<unsigned char>> levels;
+	std::vector<std::pair<int, int>> sizes;
+	levels.emplace_back(pixels, pixels + (size_t)width * height * channels);
+	sizes.push_back({width, height});
+	stbi_image_free(pixels);
+	while (sizes.back().first > 1 || sizes.back().second > 1)
+	{
+		int srcW = sizes.back().first, srcH = sizes.back().second;
+		int dstW = std::max(1, srcW / 2), dstH = std::max(1, srcH / 2);
+		const std::vector<unsigned char> &src = levels.back();
+		std::vector<unsigned char> dst((size_t)dstW * dstH * channels);
+		for (int y = 0; y < dstH; y++)
+		{
+			int y0 = std::min(srcH - 1, y * 2), y1 = std::min(srcH - 1, y * 2 + 1);
+			for (int x = 0; x < dstW; x++)
+			{
+				int x0 = std::min(srcW - 1, x * 2), x1 = std::min(srcW - 1, x * 2 + 1);
+				for (int c = 0; c < channels; c++)
+				{
+					int sum = src[((size_t)y0 * srcW + x0) * channels + c] + src[((size_t)y0 * srcW + x1) * channels + c] +
+							  src[((size_t)y1 * srcW + x0) * channels + c] + src[((size_t)y1 * srcW + x1) * channels + c];
+					dst[((size_t)y * dstW + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		levels.push_back(std::move(dst));
+		sizes.push_back({dstW, dstH});
+	}
+
+	BakedTextureHeader header = {};
+	std::memcpy(header.magic, "BTEX", 4);
+	header.version = BakedTexture::VERSION;
+	header.width = width;
+	header.height = height;
+	header.levels = (uint32_t)levels.size();
+	header.internalFormat = internalFormats[channels];
+	header.format = formats[channels];
+	header.type = GL_UNSIGNED_BYTE;
+
+	std::vector<BakedTextureLevel> table(levels.size());
+	uint64_t offset = sizeof(BakedTextureHeader) + table.size() * sizeof(BakedTextureLevel);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = (offset + 15) & ~(uint64_t)15;
+		table[i].offset = offset;
+		table[i].size = levels[i].size();
+		table[i].width = sizes[i].first;
+		table[i].height = sizes[i].second;
+		offset += levels[i].size();
+	}
+
+	std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		spdlog::error("Failed to open baked texture output {}", outputPath);
+		return false;
+	}
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)table.data(), table.size() * sizeof(BakedTextureLevel));
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		// pad up to the level's aligned offset
+		static const char zeros[16] = {};
+		file.write(zeros, table[i].offset - (uint64_t)file.tellp());
+		file.write((const char *)levels[i].data(), levels[i].size());
+	}
+	if (!file)
+	{
+		spdlog::error("Failed to write baked texture {}", outputPath);
+		return false;
+	}
+	spdlog::info("Baked {} -> {} ({}x{}, {} levels, {} bytes)", inputPath, outputPath, width, height, levels.size(), offset);
+	return true;
+}
+#endif // !BAKED_TEXTURE_H
\ No newline at end of file
@@ -0,0 +1,316 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Camera.h"
+#include "TransformBatch.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iterator>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <chrono>
+
+// counters bumped by the render loop, reset every frame
+struct RenderStats
+{
+	uint32_t drawCalls = 0;
+	uint32_t stateChanges = 0;			// GL state calls that reached the driver
+	uint32_t stateChangesSkipped = 0;	// redundant ones dropped by GLState
+	uint32_t matricesUploaded = 0;		// instance transforms sent to the GPU
+
+	void reset() { *this = RenderStats(); }
+};
+inline RenderStats renderStats;
+
+// deterministic benchmark scene description
+struct BenchmarkConfig
+{
+	int cubes = 1000;
+	int textures = 2;
+	int frames = 600;			// measured frames
+	int warmup = 60;			// frames rendered before measuring starts
+	float animated = 1.0f;		// fraction of cubes that spin, the rest never change
+	std::string outputPath = "bench_output.json";
+};
+
+// radius of the sphere the benchmark cubes are scattered in, keeps density roughly constant
+inline float benchmarkSceneRadius(int cubes)
+{
+	return std::max(5.0f, 2.0f * std::cbrt((float)cubes));
+}
+
+// cubes scattered uniformly inside a sphere from a fixed seed, identical on every run and platform
+inline std::vector<glm::vec3> benchmarkCubePositions(int cubes, uint32_t seed = 0x9E3779B9u)
+{
+	float radius = benchmarkSceneRadius(cubes);
+	uint32_t state = seed;
+	auto next = [&state]() {
+		// xorshift32, avoids std:: distributions whose output differs between standard libraries
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state >> 8) * (1.0f / 16777216.0f) * 2.0f - 1.0f;
+	};
+
+	std::vector<glm::vec3> positions;
+	positions.reserve(cubes);
+	while ((int)positions.size() < cubes)
+	{
+		glm::vec3 p(next(), next(), next());
+		if (glm::dot(p, p) <= 1.0f)
+			positions.push_back(p * radius);
+	}
+	return positions;
+}
+
+// scripted camera: one orbit around the scene every 600 frames with a slow vertical bob,
+// a function of the frame index only so every run sees the same views
+inline void benchmarkCameraPath(Camera &camera, int frame, float sceneRadius)
+{
+	float t = frame / 600.0f * 2.0f * 3.14159265f;
+	float orbit = sceneRadius * 1.25f;
+	glm::vec3 position(std::cos(t) * orbit, std::sin(t * 3.0f) * sceneRadius * 0.25f, std::sin(t) * orbit);
+
+	// look at the origin
+	glm::vec3 toCenter = glm::normalize(-position);
+	float yaw = glm::degrees(std::atan2(toCenter.z, toCenter.x));
+	float pitch = glm::degrees(std::asin(toCenter.y));
+	camera.SetPose(position, yaw, pitch);
+}
+
+// CPU microbenchmark, no GL context needed: the per-object glm composition the render loop used
+// (translate, rotate, rotate) against composeTransforms on the same transforms held as quaternions.
+// Logs the best of iterations runs in nanoseconds per matrix and the largest element difference.
+inline void benchmarkTransformComposition(int count, int iterations = 20)
+{
+	std::vector<glm::vec3> positions = benchmarkCubePositions(count);
+	const glm::vec3 tiltAxis(1.0f, 0.3f, 0.5f), spinAxis(0.5f, 1.0f, 0.0f);
+	const glm::vec3 tiltUnit = glm::normalize(tiltAxis), spinUnit = glm::normalize(spinAxis);
+	TransformArrays arrays;
+	arrays.resize(count);
+
+	std::vector<glm::mat4> reference(count), batched;
+	double glmBest = 1e30, batchBest = 1e30;
+	for (int run = 0; run < iterations; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+			model = glm::rotate(model, glm::radians(20.0f * i), tiltAxis);
+			reference[i] = glm::rotate(model, 0.01f * i, spinAxis);
+		}
+		// the batch pays for its angle to quaternion trig too, the glm loop does the same work in rotate()
+		auto middle = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			glm::quat tilt = glm::angleAxis(glm::radians(20.0f * i), tiltUnit);
+			glm::quat spin = glm::angleAxis(0.01f * i, spinUnit);
+			arrays.set(i, positions[i], tilt * spin);
+		}
+		composeTransforms(arrays, batched);
+		auto end = std::chrono::steady_clock::now();
+		glmBest = std::min(glmBest, std::chrono::duration<double, std::nano>(middle - start).count());
+		batchBest = std::min(batchBest, std::chrono::duration<double, std::nano>(end - middle).count());
+	}
+
+	float maxDifference = 0.0f;
+	for (int i = 0; i < count; i++)
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				maxDifference = std::max(maxDifference, std::fabs(reference[i][c][r] - batched[i][c][r]));
+
+#if TRANSFORM_AVX
+	const char *path = "AVX";
+#elif TRANSFORM_SSE
+	const char *path = "SSE";
+#else
+	const char *path = "scalar";
+#endif
+	spdlog::info("Transform composition of {} matrices: glm {:.2f} ns, batch ({}) {:.2f} ns per matrix, {:.1f}x, max difference {:.2e}", count,
+		glmBest / count, path, batchBest / count, glmBest / std::max(batchBest, 1.0), maxDifference);
+}
+
+// GPU frame time via GL_TIME_ELAPSED, results are read a few frames late so the CPU never waits
+class GpuFrameTimer
+{
+public:
+	GpuFrameTimer()
+	{
+		glGenQueries(LATENCY, queries);
+	}
+
+	~GpuFrameTimer()
+	{
+		glDeleteQueries(LATENCY, queries);
+	}
+
+	GpuFrameTimer(const GpuFrameTimer &) = delete;
+	GpuFrameTimer &operator=(const GpuFrameTimer &) = delete;
+
+	void begin()
+	{
+		// slot still in flight from LATENCY frames ago, wait for it rather than lose the sample
+		if (pending[next])
+			collect(next, true);
+		glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+	}
+
+	void end(bool record)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[next] = true;
+		recorded[next] = record;
+		next = (next + 1) % LATENCY;
+
+		// pick up whatever finished without blocking
+		for (int i = 0; i < LATENCY; i++)
+		{
+			if (pending[i])
+				collect(i, false);
+		}
+	}
+
+	// drain every outstanding query, call once after the last frame
+	void flush()
+	{
+		for (int i = 0; i < LATENCY; i++)
+		{
+			if (pending[i])
+				collect(i, true);
+		}
+	}
+
+	std::vector<double> samplesMs;
+
+private:
+	static const int LATENCY = 4;
+	GLuint queries[LATENCY];
+	bool pending[LATENCY] = {};
+	bool recorded[LATENCY] = {};
+	int next = 0;
+
+	void collect(int slot, bool wait)
+	{
+		GLint available = 0;
+		if (!wait)
+		{
+			glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				return;
+		}
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+		if (recorded[slot])
+			samplesMs.push_back(elapsed / 1.0e6);
+		pending[slot] = false;
+	}
+};
+
+// per-frame samples of a benchmark run, summarized as percentiles
+class BenchmarkRecorder
+{
+public:
+	std::vector<double> cpuMs;
+	std::vector<double> drawCalls;
+	std::vector<double> stateChanges;
+	std::vector<double> stateChangesSkipped;
+	std::vector<double> matricesUploaded;
+
+	void addFrame(double frameCpuMs, const RenderStats &stats)
+	{
+		cpuMs.push_back(frameCpuMs);
+		drawCalls.push_back(stats.drawCalls);
+		stateChanges.push_back(stats.stateChanges);
+		stateChangesSkipped.push_back(stats.stateChangesSkipped);
+		matricesUploaded.push_back(stats.matricesUploaded);
+	}
+
+	// nearest-rank percentile, p in [0, 100]
+	static double percentile(std::vector<double> samples, double p)
+	{
+		if (samples.empty())
+			return 0.0;
+		std::sort(samples.begin(), samples.end());
+		size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+		return samples[std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	bool writeJson(const std::string &path, const BenchmarkConfig &config, int width, int height, const std::vector<double> &gpuMs, const std::vector<double> &latencyMs,
+		const std::map<std::string, std::vector<double>> &gpuPassMs) const
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			spdlog::error("Failed to open benchmark output {}", path);
+			return false;
+		}
+
+		const GLubyte *renderer = glGetString(GL_RENDERER);
+		file << "{\n";
+		file << "  \"scene\": {\"cubes\": " << config.cubes << ", \"textures\": " << config.textures
+			 << ", \"frames\": " << cpuMs.size() << ", \"warmup\": " << config.warmup
+			 << ", \"animated\": " << config.animated
+			 << ", \"width\": " << width << ", \"height\": " << height << "},\n";
+		file << "  \"renderer\": \"" << escape(renderer ? (const char *)renderer : "") << "\",\n";
+		writeSeries(file, "cpu_frame_ms", cpuMs, false);
+		writeSeries(file, "gpu_frame_ms", gpuMs, false);
+		writeSeries(file, "input_latency_ms", latencyMs, false);
+		file << "  \"gpu_pass_ms\": {\n";
+		for (auto pass = gpuPassMs.begin(); pass != gpuPassMs.end(); ++pass)
+			writeSeries(file, escape(pass->first).c_str(), pass->second, std::next(pass) == gpuPassMs.end(), "    ");
+		file << "  },\n";
+		writeSeries(file, "draw_calls", drawCalls, false);
+		writeSeries(file, "state_changes", stateChanges, false);
+		writeSeries(file, "state_changes_skipped", stateChangesSkipped, false);
+		writeSeries(file, "matrices_uploaded", matricesUploaded, true);
+		file << "}\n";
+
+		spdlog::info("Benchmark: cpu p50 {:.3f} ms p95 {:.3f} ms p99 {:.3f} ms, gpu p50 {:.3f} ms p95 {:.3f} ms p99 {:.3f} ms",
+			percentile(cpuMs, 50), percentile(cpuMs, 95), percentile(cpuMs, 99),
+			percentile(gpuMs, 50), percentile(gpuMs, 95), percentile(gpuMs, 99));
+		spdlog::info("Benchmark results written to {}", path);
+		return (bool)file;
+	}
+
+private:
+	static void writeSeries(std::ofstream &file, const char *name, const std::vector<double> &samples, bool last, const char *indent = "  ")
+	{
+		double mean = 0.0;
+		for (double s : samples)
+			mean += s;
+		if (!samples.empty())
+			mean /= samples.size();
+
+		file << indent << "\"" << name << "\": {\"samples\": " << samples.size()
+			 << ", \"mean\": " << mean
+			 << ", \"p50\": " << percentile(samples, 50)
+			 << ", \"p95\": " << percentile(samples, 95)
+			 << ", \"p99\": " << percentile(samples, 99)
+			 << ", \"max\": " << (samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end()))
+			 << "}" << (last ? "\n" : ",\n");
+	}
+
+	static std::string escape(const std::string &text)
+	{
+		std::string out;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+		return out;
+	}
+};
+#endif // !BENCHMARK_H
\ No newline at end of file
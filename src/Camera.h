@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
 #include <vector>
 
 enum Camera_Movement {
@@ -67,6 +69,27 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // returns the perspective projection for the current zoom
+    glm::mat4 GetProjectionMatrix(float aspect, float nearPlane, float farPlane)
+    {
+        return glm::perspective(glm::radians(Zoom), aspect, nearPlane, farPlane);
+    }
+
+    // returns the world space view frustum, planes extracted from the view-projection matrix
+    Frustum GetFrustum(float aspect, float nearPlane, float farPlane)
+    {
+        return Frustum::fromMatrix(GetProjectionMatrix(aspect, nearPlane, farPlane) * GetViewMatrix());
+    }
+
+    // places the camera directly, used by scripted camera paths instead of user input
+    void SetPose(glm::vec3 position, float yaw, float pitch)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
@@ -0,0 +1,137 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <spdlog/spdlog.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <filesystem>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Reports edits to a set of files. On Linux it watches their directories through a non-blocking inotify
+// descriptor, editors that save by writing a temp file and renaming it over the original still show up
+// as a change. Elsewhere it falls back to comparing modification times, at most a few times a second.
+class FileWatcher
+{
+public:
+	FileWatcher()
+	{
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0)
+			spdlog::warn("inotify unavailable ({}), falling back to polling file times", errno);
+#endif
+	}
+
+	~FileWatcher()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher &operator=(const FileWatcher &) = delete;
+
+	bool watch(const std::string &path)
+	{
+		std::filesystem::path file = normalize(path);
+		std::error_code ec;
+		files[file.string()] = std::filesystem::last_write_time(file, ec);
+		if (ec)
+		{
+			spdlog::warn("Can't watch {}: {}", path, ec.message());
+			files.erase(file.string());
+			return false;
+		}
+
+#ifdef __linux__
+		if (fd >= 0)
+		{
+			std::string directory = file.parent_path().string();
+			for (const auto &watched : directories)
+			{
+				if (watched.second == directory)
+					return true;
+			}
+			int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (wd < 0)
+			{
+				spdlog::warn("inotify_add_watch failed for {} ({})", directory, errno);
+				return false;
+			}
+			directories[wd] = directory;
+		}
+#endif
+		return true;
+	}
+
+	// watched files changed since the last call, never blocks
+	std::vector<std::string> poll()
+	{
+		std::set<std::string> changed;
+#ifdef __linux__
+		if (fd >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+			{
+				for (char *p = buffer; p < buffer + length;)
+				{
+					const inotify_event *event = (const inotify_event *)p;
+					p += sizeof(inotify_event) + event->len;
+					auto directory = directories.find(event->wd);
+					if (directory == directories.end() || event->len == 0)
+						continue;
+					std::string file = (std::filesystem::path(directory->second) / event->name).string();
+					if (files.count(file))
+						changed.insert(file);
+				}
+			}
+			return std::vector<std::string>(changed.begin(), changed.end());
+		}
+#endif
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastScan < std::chrono::milliseconds(250))
+			return {};
+		lastScan = now;
+		for (auto &file : files)
+		{
+			std::error_code ec;
+			auto time = std::filesystem::last_write_time(file.first, ec);
+			if (!ec && time != file.second)
+			{
+				file.second = time;
+				changed.insert(file.first);
+			}
+		}
+		return std::vector<std::string>(changed.begin(), changed.end());
+	}
+
+private:
+	std::map<std::string, std::filesystem::file_time_type> files;
+	std::chrono::steady_clock::time_point lastScan;
+#ifdef __linux__
+	int fd = -1;
+	std::map<int, std::string> directories;
+#endif
+
+	// absolute and lexically normal, so event paths and watched paths compare equal
+	static std::filesystem::path normalize(const std::string &path)
+	{
+		std::error_code ec;
+		std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+		return (ec ? std::filesystem::path(path) : absolute).lexically_normal();
+	}
+};
+#endif // !FILE_WATCHER_H
\ No newline at end of file
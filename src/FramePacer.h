@@ -0,0 +1,166 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+// Keeps the CPU at most framesInFlight frames ahead of the GPU with a fence per frame, so the driver
+// can't queue up several frames of stale input. Also measures input to present latency: the GPU clock
+// is read when input is sampled and a timestamp query lands right after the swap, the difference is
+// how long the sampled input took to reach a finished frame.
+class FramePacer
+{
+public:
+	static const int MAX_FRAMES_IN_FLIGHT = 7;
+
+	// 0 disables throttling, latency is still measured
+	explicit FramePacer(int framesInFlight = 2) : framesInFlight(std::min(std::max(framesInFlight, 0), MAX_FRAMES_IN_FLIGHT))
+	{
+		for (Slot &slot : slots)
+			glGenQueries(1, &slot.query);
+	}
+
+	~FramePacer()
+	{
+		for (Slot &slot : slots)
+		{
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			glDeleteQueries(1, &slot.query);
+		}
+	}
+
+	FramePacer(const FramePacer &) = delete;
+	FramePacer &operator=(const FramePacer &) = delete;
+
+	// call before any work of the frame, blocks until the frame framesInFlight back has finished on the GPU.
+	// Returns the time spent waiting in milliseconds.
+	double throttle()
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (framesInFlight > 0 && frame >= (uint64_t)framesInFlight)
+		{
+			Slot &oldest = slots[(frame - framesInFlight) % SLOTS];
+			if (oldest.pending)
+				waitFence(oldest);
+		}
+		for (Slot &slot : slots)
+		{
+			if (slot.pending)
+				collect(slot, false);
+		}
+		lastWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return lastWaitMs;
+	}
+
+	// call right after input was sampled, before anything that depends on it is built
+	void markInput(bool record = true)
+	{
+		Slot &slot = slots[frame % SLOTS];
+		if (slot.pending)
+			collect(slot, true); // unthrottled and lapped, the sample must not be lost
+		glGetInteger64v(GL_TIMESTAMP, &slot.inputTime);
+		slot.recorded = record;
+		slot.marked = true;
+	}
+
+	// call after the buffer swap
+	void endFrame()
+	{
+		Slot &slot = slots[frame % SLOTS];
+		if (slot.marked)
+			glQueryCounter(slot.query, GL_TIMESTAMP);
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.pending = true;
+		frame++;
+	}
+
+	// wait for every frame still on the GPU, call once after the last frame
+	void flush()
+	{
+		for (Slot &slot : slots)
+		{
+			if (slot.pending)
+				collect(slot, true);
+		}
+	}
+
+	int maxFramesInFlight() const { return framesInFlight; }
+	double lastWait() const { return lastWaitMs; }
+	double lastLatency() const { return lastLatencyMs; }
+
+	// input to present latency of recorded frames, in completion order
+	std::vector<double> latencyMs;
+
+private:
+	static const int SLOTS = MAX_FRAMES_IN_FLIGHT + 1;
+
+	struct Slot
+	{
+		GLsync fence = 0;
+		GLuint query = 0;
+		GLint64 inputTime = 0;
+		bool pending = false;
+		bool marked = false;
+		bool recorded = false;
+	};
+
+	Slot slots[SLOTS];
+	int framesInFlight;
+	uint64_t frame = 0;
+	double lastWaitMs = 0.0;
+	double lastLatencyMs = 0.0;
+
+	static void waitFence(Slot &slot)
+	{
+		// flush on the first wait so the fence is guaranteed to reach the GPU
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		for (;;)
+		{
+			GLenum result = glClientWaitSync(slot.fence, flags, 100000000); // 100 ms per round
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+				return;
+			if (result == GL_WAIT_FAILED)
+			{
+				spdlog::error("glClientWaitSync failed, frame pacing disabled for this frame");
+				return;
+			}
+			flags = 0;
+		}
+	}
+
+	void collect(Slot &slot, bool wait)
+	{
+		if (wait)
+			waitFence(slot);
+		else
+		{
+			GLint status = GL_UNSIGNALED;
+			glGetSynciv(slot.fence, GL_SYNC_STATUS, 1, NULL, &status);
+			if (status != GL_SIGNALED)
+				return;
+		}
+
+		if (slot.marked)
+		{
+			// the fence follows the query, so the result is ready once it signalled
+			GLuint64 presented = 0;
+			glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &presented);
+			lastLatencyMs = ((GLint64)presented - slot.inputTime) / 1.0e6;
+			if (slot.recorded)
+				latencyMs.push_back(lastLatencyMs);
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		slot.pending = false;
+		slot.marked = false;
+	}
+};
+#endif // !FRAME_PACER_H
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "GLState.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+// Offscreen render target, RGBA8 color and 24/8 depth stencil renderbuffers
+class Framebuffer
+{
+public:
+	// framebuffer object id
+	unsigned int ID;
+	int width, height;
+
+	Framebuffer(int width, int height) : width(width), height(height)
+	{
+		glGenFramebuffers(1, &ID);
+		glGenRenderbuffers(1, &colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		GLState::get().bindFramebuffer(GL_FRAMEBUFFER, ID);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			spdlog::error("Offscreen framebuffer is incomplete");
+		}
+		GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	~Framebuffer()
+	{
+		GLState::get().forgetFramebuffer(ID);
+		glDeleteFramebuffers(1, &ID);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+
+	Framebuffer(const Framebuffer &) = delete;
+	Framebuffer &operator=(const Framebuffer &) = delete;
+
+	// render into this target instead of the default framebuffer
+	void bind()
+	{
+		GLState::get().bindFramebuffer(GL_FRAMEBUFFER, ID);
+		GLState::get().viewport(0, 0, width, height);
+	}
+
+	// read back the color attachment as tightly packed RGB rows, top row first
+	std::vector<uint8_t> readPixels()
+	{
+		std::vector<uint8_t> pixels((size_t)width * height * 3);
+		GLState::get().bindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+		// GL rows start at the bottom
+		size_t stride = (size_t)width * 3;
+		std::vector<uint8_t> row(stride);
+		for (int y = 0; y < height / 2; y++)
+		{
+			uint8_t *top = pixels.data() + y * stride;
+			uint8_t *bottom = pixels.data() + (height - 1 - y) * stride;
+			std::copy(top, top + stride, row.data());
+			std::copy(bottom, bottom + stride, top);
+			std::copy(row.data(), row.data() + stride, bottom);
+		}
+		return pixels;
+	}
+
+	// dump the color attachment as a binary PPM, returns false on write failure
+	bool writePPM(const std::string &path)
+	{
+		std::vector<uint8_t> pixels = readPixels();
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+		{
+			spdlog::error("Failed to open frame dump file {}", path);
+			return false;
+		}
+		file << "P6\n" << width << " " << height << "\n255\n";
+		file.write((const char *)pixels.data(), pixels.size());
+		return (bool)file;
+	}
+
+private:
+	unsigned int colorBuffer, depthBuffer;
+};
+#endif // !FRAMEBUFFER_H
\ No newline at end of file
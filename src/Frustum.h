@@ -0,0 +1,235 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE 1
+#include <immintrin.h>
+#endif
+#if defined(__AVX__)
+#define FRUSTUM_AVX 1
+#endif
+
+// View frustum as six inward facing planes (xyz normal, w distance), extracted from a view-projection matrix
+struct Frustum
+{
+	glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+	// Gribb/Hartmann extraction, planes are normalized so distances are in world units
+	static Frustum fromMatrix(const glm::mat4 &m)
+	{
+		// rows of the column-major matrix
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum f;
+		f.planes[0] = row3 + row0;
+		f.planes[1] = row3 - row0;
+		f.planes[2] = row3 + row1;
+		f.planes[3] = row3 - row1;
+		f.planes[4] = row3 + row2;
+		f.planes[5] = row3 - row2;
+		for (glm::vec4 &p : f.planes)
+		{
+			float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+			p = p * (1.0f / length);
+		}
+		return f;
+	}
+};
+
+// Bounding spheres in structure-of-arrays form, one SIMD lane per object
+struct BoundingSpheres
+{
+	std::vector<float> x, y, z, radius;
+
+	size_t size() const { return x.size(); }
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		radius.clear();
+	}
+
+	void add(const glm::vec3 &center, float r)
+	{
+		x.push_back(center.x);
+		y.push_back(center.y);
+		z.push_back(center.z);
+		radius.push_back(r);
+	}
+};
+
+// Axis aligned boxes in structure-of-arrays form, stored as center and half extents
+struct BoundingBoxes
+{
+	std::vector<float> x, y, z;		// center
+	std::vector<float> ex, ey, ez;	// half extents
+
+	size_t size() const { return x.size(); }
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		ex.clear();
+		ey.clear();
+		ez.clear();
+	}
+
+	void add(const glm::vec3 &min, const glm::vec3 &max)
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extent = (max - min) * 0.5f;
+		x.push_back(center.x);
+		y.push_back(center.y);
+		z.push_back(center.z);
+		ex.push_back(extent.x);
+		ey.push_back(extent.y);
+		ez.push_back(extent.z);
+	}
+};
+
+namespace culling
+{
+	// an object is outside when it is fully behind any plane: dot(n, c) + w < -r
+	inline bool sphereVisible(const Frustum &f, float x, float y, float z, float r)
+	{
+		for (const glm::vec4 &p : f.planes)
+		{
+			if (p.x * x + p.y * y + p.z * z + p.w < -r)
+				return false;
+		}
+		return true;
+	}
+
+	// box projected radius onto the plane normal is the sum of |n| * extent
+	inline bool boxVisible(const Frustum &f, float x, float y, float z, float ex, float ey, float ez)
+	{
+		for (const glm::vec4 &p : f.planes)
+		{
+			float r = std::fabs(p.x) * ex + std::fabs(p.y) * ey + std::fabs(p.z) * ez;
+			if (p.x * x + p.y * y + p.z * z + p.w < -r)
+				return false;
+		}
+		return true;
+	}
+
+#if FRUSTUM_SSE
+	// append the indices of set bits in a lane mask
+	inline void appendLanes(int mask, uint32_t base, std::vector<uint32_t> &visible)
+	{
+		while (mask)
+		{
+			int lane = 0;
+			while (!(mask & (1 << lane)))
+				lane++;
+			visible.push_back(base + lane);
+			mask &= mask - 1;
+		}
+	}
+#endif
+}
+
+// Write indices of spheres intersecting the frustum into visible, in ascending order. Returns the visible count.
+// first/last limit the test to a range of the spheres, so chunks can be culled on different threads.
+inline size_t cullSpheres(const Frustum &f, const BoundingSpheres &spheres, std::vector<uint32_t> &visible, size_t first = 0, size_t last = SIZE_MAX)
+{
+	visible.clear();
+	const size_t count = std::min(last, spheres.size());
+	size_t i = first;
+
+#if FRUSTUM_AVX
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&spheres.x[i]);
+		__m256 y = _mm256_loadu_ps(&spheres.y[i]);
+		__m256 z = _mm256_loadu_ps(&spheres.z[i]);
+		__m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const glm::vec4 &p : f.planes)
+		{
+			__m256 d = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.x)), _mm256_mul_ps(y, _mm256_set1_ps(p.y))),
+				_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(p.z)), _mm256_set1_ps(p.w)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+		}
+		culling::appendLanes(_mm256_movemask_ps(inside), (uint32_t)i, visible);
+	}
+#endif
+#if FRUSTUM_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.x[i]);
+		__m128 y = _mm_loadu_ps(&spheres.y[i]);
+		__m128 z = _mm_loadu_ps(&spheres.z[i]);
+		__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4 &p : f.planes)
+		{
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+		}
+		culling::appendLanes(_mm_movemask_ps(inside), (uint32_t)i, visible);
+	}
+#endif
+	// scalar tail, or the whole array without SSE
+	for (; i < count; i++)
+	{
+		if (culling::sphereVisible(f, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]))
+			visible.push_back((uint32_t)i);
+	}
+	return visible.size();
+}
+
+// Write indices of boxes intersecting the frustum into visible, in ascending order. Returns the visible count.
+inline size_t cullBoxes(const Frustum &f, const BoundingBoxes &boxes, std::vector<uint32_t> &visible)
+{
+	visible.clear();
+	const size_t count = boxes.size();
+	size_t i = 0;
+
+#if FRUSTUM_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&boxes.x[i]);
+		__m128 y = _mm_loadu_ps(&boxes.y[i]);
+		__m128 z = _mm_loadu_ps(&boxes.z[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.ex[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.ey[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.ez[i]);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4 &p : f.planes)
+		{
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+			__m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(p.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(p.y)))),
+				_mm_mul_ps(ez, _mm_set1_ps(std::fabs(p.z))));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_sub_ps(_mm_setzero_ps(), r)));
+		}
+		culling::appendLanes(_mm_movemask_ps(inside), (uint32_t)i, visible);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		if (culling::boxVisible(f, boxes.x[i], boxes.y[i], boxes.z[i], boxes.ex[i], boxes.ey[i], boxes.ez[i]))
+			visible.push_back((uint32_t)i);
+	}
+	return visible.size();
+}
+#endif // !FRUSTUM_H
\ No newline at end of file
@@ -0,0 +1,350 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+// Shadow copy of the bind points and fixed-function state the renderer touches. Calls that would not
+// change anything are dropped before they reach the driver. Anything that changes GL state behind
+// its back must call invalidate(), and deleted objects must be forgotten so a recycled name is rebound.
+class GLState
+{
+public:
+	// issued reached the driver, skipped were redundant
+	struct Counters
+	{
+		uint32_t issued = 0;
+		uint32_t skipped = 0;
+	};
+
+	static const int MAX_TEXTURE_UNITS = 32;
+
+	// state of the current context, the renderer only ever has one
+	static GLState &get()
+	{
+		static GLState state;
+		return state;
+	}
+
+	// counters since the last resetCounters(), call once per frame
+	const Counters &counters() const { return frameCounters; }
+	void resetCounters() { frameCounters = Counters(); }
+
+	// forget everything, the next call of each kind goes through
+	void invalidate()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		arrayBuffer = UNKNOWN;
+		elementBuffer = UNKNOWN;
+		uniformBuffer = UNKNOWN;
+		drawIndirectBuffer = UNKNOWN;
+		readFramebuffer = UNKNOWN;
+		drawFramebuffer = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (auto &unit : textures)
+			for (GLuint &binding : unit)
+				binding = UNKNOWN;
+		for (UniformRange &range : uniformRanges)
+			range.buffer = UNKNOWN;
+		for (int &cap : capabilities)
+			cap = -1;
+		for (GLint &v : viewportRect)
+			v = -1;
+	}
+
+	void useProgram(GLuint id)
+	{
+		if (change(program, id))
+			glUseProgram(id);
+	}
+
+	void bindVertexArray(GLuint id)
+	{
+		if (change(vertexArray, id))
+		{
+			glBindVertexArray(id);
+			// the element array binding is vertex array state
+			elementBuffer = UNKNOWN;
+		}
+	}
+
+	void bindBuffer(GLenum target, GLuint id)
+	{
+		GLuint *slot = bufferSlot(target);
+		if (!slot)
+		{
+			frameCounters.issued++;
+			glBindBuffer(target, id);
+		}
+		else if (change(*slot, id))
+		{
+			glBindBuffer(target, id);
+		}
+	}
+
+	// indexed uniform buffer binding, also moves the generic GL_UNIFORM_BUFFER binding
+	void bindBufferRange(GLenum target, GLuint index, GLuint id, GLintptr offset, GLsizeiptr size)
+	{
+		if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS)
+		{
+			frameCounters.issued++;
+			glBindBufferRange(target, index, id, offset, size);
+			return;
+		}
+		UniformRange &range = uniformRanges[index];
+		if (range.buffer == id && range.offset == offset && range.size == size)
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		frameCounters.issued++;
+		range = {id, offset, size};
+		uniformBuffer = id;
+		glBindBufferRange(target, index, id, offset, size);
+	}
+
+	// bind on a specific unit, glActiveTexture is only issued when the unit has to change
+	void bindTexture(GLuint unit, GLenum target, GLuint id)
+	{
+		int slot = textureSlot(target);
+		if (unit >= MAX_TEXTURE_UNITS || slot < 0)
+		{
+			activeTexture(unit);
+			frameCounters.issued++;
+			glBindTexture(target, id);
+			return;
+		}
+		if (textures[unit][slot] == id)
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		activeTexture(unit);
+		frameCounters.issued++;
+		textures[unit][slot] = id;
+		glBindTexture(target, id);
+	}
+
+	// bind on whatever unit is active, for creating and updating textures
+	void bindTexture(GLenum target, GLuint id)
+	{
+		if (activeUnit == UNKNOWN)
+			activeTexture(0);
+		bindTexture(activeUnit, target, id);
+	}
+
+	void bindFramebuffer(GLenum target, GLuint id)
+	{
+		bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+		bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+		if ((!read || readFramebuffer == id) && (!draw || drawFramebuffer == id))
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		frameCounters.issued++;
+		if (read)
+			readFramebuffer = id;
+		if (draw)
+			drawFramebuffer = id;
+		glBindFramebuffer(target, id);
+	}
+
+	// GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST, others pass straight through
+	void setEnabled(GLenum cap, bool enabled)
+	{
+		int slot = capabilitySlot(cap);
+		if (slot >= 0 && capabilities[slot] == (int)enabled)
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		frameCounters.issued++;
+		if (slot >= 0)
+			capabilities[slot] = (int)enabled;
+		if (enabled)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+
+	void blendFunc(GLenum source, GLenum destination)
+	{
+		if (blendSource == source && blendDestination == destination)
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		frameCounters.issued++;
+		blendSource = source;
+		blendDestination = destination;
+		glBlendFunc(source, destination);
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (change(depthFunction, func))
+			glDepthFunc(func);
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height)
+		{
+			frameCounters.skipped++;
+			return;
+		}
+		frameCounters.issued++;
+		viewportRect[0] = x;
+		viewportRect[1] = y;
+		viewportRect[2] = width;
+		viewportRect[3] = height;
+		glViewport(x, y, width, height);
+	}
+
+	// deleting an object implicitly unbinds it, drop it from the cache so a recycled name is rebound
+	void forgetProgram(GLuint id)
+	{
+		if (program == id)
+			program = UNKNOWN;
+	}
+	void forgetVertexArray(GLuint id)
+	{
+		if (vertexArray == id)
+			vertexArray = UNKNOWN;
+	}
+	void forgetBuffer(GLuint id)
+	{
+		for (GLuint *slot : {&arrayBuffer, &elementBuffer, &uniformBuffer, &drawIndirectBuffer})
+		{
+			if (*slot == id)
+				*slot = UNKNOWN;
+		}
+		for (UniformRange &range : uniformRanges)
+		{
+			if (range.buffer == id)
+				range.buffer = UNKNOWN;
+		}
+	}
+	void forgetTexture(GLuint id)
+	{
+		for (auto &unit : textures)
+			for (GLuint &binding : unit)
+				if (binding == id)
+					binding = UNKNOWN;
+	}
+	void forgetFramebuffer(GLuint id)
+	{
+		if (readFramebuffer == id)
+			readFramebuffer = UNKNOWN;
+		if (drawFramebuffer == id)
+			drawFramebuffer = UNKNOWN;
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	static const int TEXTURE_TARGETS = 5; // 2D, 2D array, cube map, 3D, buffer
+	static const int CAPABILITIES = 4;
+	static const GLuint MAX_UNIFORM_BINDINGS = 16;
+
+	struct UniformRange
+	{
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	Counters frameCounters;
+	GLuint program, vertexArray;
+	GLuint arrayBuffer, elementBuffer, uniformBuffer, drawIndirectBuffer;
+	GLuint readFramebuffer, drawFramebuffer;
+	GLuint activeUnit;
+	GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+	UniformRange uniformRanges[MAX_UNIFORM_BINDINGS];
+	int capabilities[CAPABILITIES]; // -1 unknown
+	GLenum blendSource = UNKNOWN, blendDestination = UNKNOWN;
+	GLenum depthFunction = UNKNOWN;
+	GLint viewportRect[4];
+
+	GLState()
+	{
+		invalidate();
+	}
+
+	// returns true when the value differs and the call has to be issued
+	bool change(GLuint &cached, GLuint value)
+	{
+		if (cached == value)
+		{
+			frameCounters.skipped++;
+			return false;
+		}
+		frameCounters.issued++;
+		cached = value;
+		return true;
+	}
+
+	void activeTexture(GLuint unit)
+	{
+		if (change(activeUnit, unit))
+			glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	GLuint *bufferSlot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return &arrayBuffer;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return &elementBuffer;
+		case GL_UNIFORM_BUFFER:
+			return &uniformBuffer;
+		case GL_DRAW_INDIRECT_BUFFER:
+			return &drawIndirectBuffer;
+		default:
+			return NULL;
+		}
+	}
+
+	static int textureSlot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D:
+			return 0;
+		case GL_TEXTURE_2D_ARRAY:
+			return 1;
+		case GL_TEXTURE_CUBE_MAP:
+			return 2;
+		case GL_TEXTURE_3D:
+			return 3;
+		case GL_TEXTURE_BUFFER:
+			return 4;
+		default:
+			return -1;
+		}
+	}
+
+	static int capabilitySlot(GLenum cap)
+	{
+		switch (cap)
+		{
+		case GL_DEPTH_TEST:
+			return 0;
+		case GL_BLEND:
+			return 1;
+		case GL_CULL_FACE:
+			return 2;
+		case GL_SCISSOR_TEST:
+			return 3;
+		default:
+			return -1;
+		}
+	}
+};
+#endif // !GL_STATE_H
\ No newline at end of file
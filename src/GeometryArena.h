@@ -0,0 +1,200 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "GLState.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "InstanceBuffer.h"
+
+#include <vector>
+#include <algorithm>
+
+// All static meshes suballocated out of one vertex and one index buffer behind a single vertex array.
+// Meshes are addressed by base vertex and first index, so draws of different meshes only differ in
+// their command and a batch of them goes out as one glMultiDrawElementsIndirect. Below GL 4.3 each command
+// is drawn on its own.
+class GeometryArena
+{
+public:
+	// where a mesh lives in the shared buffers
+	struct MeshRange
+	{
+		GLint baseVertex;
+		GLuint firstIndex;
+		GLsizei indexCount;
+		float radius; // bounding sphere around the mesh origin
+	};
+
+	// DrawElementsIndirectCommand layout
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// vertex array id
+	unsigned int ID;
+
+	// every mesh is quantized into the layout against the same box, the shader decodes with one set of uniforms
+	GeometryArena(const VertexLayout &layout, const PositionQuantization &quantization, size_t vertexCapacity = 64 * 1024, size_t indexCapacity = 256 * 1024)
+		: layout(layout), positionQuantization(quantization), vertexCapacity(vertexCapacity), indexCapacity(indexCapacity)
+	{
+		glGenVertexArrays(1, &ID);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+		glGenBuffers(1, &indirectBuffer);
+
+		GLState &state = GLState::get();
+		state.bindVertexArray(ID);
+		state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.stride(), NULL, GL_STATIC_DRAW);
+		layout.apply();
+		state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+	}
+
+	~GeometryArena()
+	{
+		GLState &state = GLState::get();
+		state.forgetVertexArray(ID);
+		for (GLuint buffer : {vertexBuffer, indexBuffer, indirectBuffer})
+			state.forgetBuffer(buffer);
+		glDeleteVertexArrays(1, &ID);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		glDeleteBuffers(1, &indirectBuffer);
+	}
+
+	GeometryArena(const GeometryArena &) = delete;
+	GeometryArena &operator=(const GeometryArena &) = delete;
+
+	// quantize and append a mesh, returns its index for mesh()
+	int add(const MeshData &mesh)
+	{
+		QuantizedVertices packed = quantizeVertices(mesh, layout, positionQuantization);
+		size_t vertexCount = mesh.vertexCount();
+		reserve(vertexUsed + vertexCount, indexUsed + mesh.indices.size());
+
+		GLState &state = GLState::get();
+		state.bindVertexArray(ID);
+		state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, vertexUsed * layout.stride(), packed.data.size(), packed.data.data());
+		state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexUsed * sizeof(GLuint), mesh.indices.size() * sizeof(GLuint), mesh.indices.data());
+
+		meshes.push_back({(GLint)vertexUsed, (GLuint)indexUsed, (GLsizei)mesh.indices.size(), meshBoundingRadius(mesh)});
+		vertexUsed += vertexCount;
+		indexUsed += mesh.indices.size();
+		return (int)meshes.size() - 1;
+	}
+
+	const MeshRange &mesh(int index) const { return meshes[index]; }
+	size_t meshCount() const { return meshes.size(); }
+	const PositionQuantization &quantization() const { return positionQuantization; }
+
+	void bind()
+	{
+		GLState::get().bindVertexArray(ID);
+	}
+
+	// upload this frame's commands once, multiDraw() then draws slices of them
+	void uploadCommands(const std::vector<DrawCommand> &frameCommands)
+	{
+		commands = frameCommands;
+		if (!GLAD_GL_VERSION_4_3 || commands.empty())
+			return;
+		GLState::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		// orphan, last frame's commands may still be read by the GPU
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+	}
+
+	// draw commands [first, first + count) of the uploaded set, the arena must be bound and the instance
+	// buffer attached to it. Returns the number of GL draw calls it took.
+	int multiDraw(size_t first, size_t count, InstanceBuffer &instances)
+	{
+		if (count == 0)
+			return 0;
+		if (GLAD_GL_VERSION_4_3)
+		{
+			GLState::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *)(first * sizeof(DrawCommand)), (GLsizei)count, 0);
+			return 1;
+		}
+
+		// before GL 4.3 there is no indirect multi-draw, every command is its own draw call
+		int calls = 0;
+		for (size_t i = first; i < first + count; i++)
+		{
+			const DrawCommand &command = commands[i];
+			if (GLAD_GL_VERSION_4_2)
+			{
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (const void *)(command.firstIndex * sizeof(GLuint)),
+					command.instanceCount, command.baseVertex, command.baseInstance);
+			}
+			else
+			{
+				instances.rebase(command.baseInstance);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (const void *)(command.firstIndex * sizeof(GLuint)),
+					command.instanceCount, command.baseVertex);
+				instances.rebase(0);
+			}
+			calls++;
+		}
+		return calls;
+	}
+
+private:
+	VertexLayout layout;
+	PositionQuantization positionQuantization;
+	unsigned int vertexBuffer, indexBuffer, indirectBuffer;
+	size_t vertexCapacity, indexCapacity;
+	size_t vertexUsed = 0, indexUsed = 0;
+	std::vector<MeshRange> meshes;
+	std::vector<DrawCommand> commands;
+
+
+	// grow by doubling, contents move over with a GPU side copy
+	void reserve(size_t vertices, size_t indices)
+	{
+		if (vertices > vertexCapacity)
+		{
+			size_t capacity = std::max(vertices, vertexCapacity * 2);
+			vertexBuffer = grow(vertexBuffer, vertexUsed * layout.stride(), capacity * layout.stride());
+			vertexCapacity = capacity;
+			GLState::get().bindVertexArray(ID);
+			GLState::get().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			layout.apply(); // attributes captured the old buffer
+		}
+		if (indices > indexCapacity)
+		{
+			size_t capacity = std::max(indices, indexCapacity * 2);
+			indexBuffer = grow(indexBuffer, indexUsed * sizeof(GLuint), capacity * sizeof(GLuint));
+			indexCapacity = capacity;
+			GLState::get().bindVertexArray(ID);
+			GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		}
+	}
+
+	static GLuint grow(GLuint buffer, size_t usedBytes, size_t newBytes)
+	{
+		GLState &state = GLState::get();
+		GLuint replacement;
+		glGenBuffers(1, &replacement);
+		state.bindBuffer(GL_COPY_WRITE_BUFFER, replacement);
+		glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+		state.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+		if (usedBytes > 0)
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+		state.forgetBuffer(buffer);
+		glDeleteBuffers(1, &buffer);
+		SPDLOG_DEBUG("Geometry arena buffer {} grown to {} bytes", replacement, newBytes);
+		return replacement;
+	}
+};
+#endif // !GEOMETRY_ARENA_H
\ No newline at end of file
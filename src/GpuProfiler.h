@@ -0,0 +1,183 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Profiler.h"
+
+#include <vector>
+#include <map>
+#include <string>
+
+// GPU pass timings from pairs of glQueryCounter(GL_TIMESTAMP) queries. Unlike GL_TIME_ELAPSED these
+// nest and can sit inside other timer queries. Queries come from a pool and a frame's results are read
+// FRAME_LATENCY frames later; a frame still not available by the time its slot comes round is dropped,
+// the CPU never waits on a query. Finished passes are also written to the "GPU" track of the CPU profiler.
+class GpuProfiler
+{
+public:
+	static const int FRAME_LATENCY = 4;
+
+	GpuProfiler() = default;
+
+	~GpuProfiler()
+	{
+		for (Frame &frame : frames)
+			release(frame);
+		if (!pool.empty())
+			glDeleteQueries((GLsizei)pool.size(), pool.data());
+	}
+
+	GpuProfiler(const GpuProfiler &) = delete;
+	GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+	// record controls whether this frame's passes land in samplesMs
+	void beginFrame(bool record)
+	{
+		collect();
+		Frame &frame = frames[current];
+		if (!frame.passes.empty())
+		{
+			dropped++;
+			release(frame);
+		}
+		frame.recorded = record;
+
+		// GPU and CPU clocks have unrelated origins, pair them up once per frame for the trace
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		frame.clockOffset = (int64_t)Profiler::get().now() - gpuNow;
+	}
+
+	void endFrame()
+	{
+		current = (current + 1) % FRAME_LATENCY;
+	}
+
+	// passes nest, every begin needs an end in the same frame
+	void begin(const char *name)
+	{
+		Frame &frame = frames[current];
+		frame.open.push_back(frame.passes.size());
+		frame.passes.push_back({name, acquire(), acquire()});
+		glQueryCounter(frame.passes.back().startQuery, GL_TIMESTAMP);
+	}
+
+	void end()
+	{
+		Frame &frame = frames[current];
+		if (frame.open.empty())
+			return;
+		frame.lastQuery = frame.passes[frame.open.back()].endQuery;
+		glQueryCounter(frame.lastQuery, GL_TIMESTAMP);
+		frame.open.pop_back();
+	}
+
+	// read back whatever is ready without blocking, or everything when wait is set (after the last frame)
+	void collect(bool wait = false)
+	{
+		for (int i = 1; i <= FRAME_LATENCY; i++)
+		{
+			Frame &frame = frames[(current + i) % FRAME_LATENCY];
+			if (frame.passes.empty() || !frame.open.empty())
+				continue;
+			if (!wait)
+			{
+				// timestamps complete in order, the last one issued covers the whole frame. That is the end of
+				// the outermost pass, not of the pass begun last.
+				GLint available = 0;
+				glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+					continue;
+			}
+
+			for (const Pass &pass : frame.passes)
+			{
+				GLuint64 start = 0, end = 0;
+				glGetQueryObjectui64v(pass.startQuery, GL_QUERY_RESULT, &start);
+				glGetQueryObjectui64v(pass.endQuery, GL_QUERY_RESULT, &end);
+				double ms = (end - start) / 1.0e6;
+				lastMs[pass.name] = ms;
+				if (frame.recorded)
+					samplesMs[pass.name].push_back(ms);
+#if PROFILER_ENABLED
+				Profiler::get().recordOnTrack("GPU", pass.name, (uint64_t)((int64_t)start + frame.clockOffset), (uint64_t)((int64_t)end + frame.clockOffset));
+#endif
+			}
+			release(frame);
+		}
+	}
+
+	// per pass samples of recorded frames, in milliseconds
+	std::map<std::string, std::vector<double>> samplesMs;
+	// latest result of every pass
+	std::map<std::string, double> lastMs;
+	// frames whose results were not ready in time
+	size_t dropped = 0;
+
+private:
+	struct Pass
+	{
+		const char *name;
+		GLuint startQuery;
+		GLuint endQuery;
+	};
+
+	struct Frame
+	{
+		std::vector<Pass> passes;
+		std::vector<size_t> open;
+		GLuint lastQuery = 0;
+		int64_t clockOffset = 0;
+		bool recorded = false;
+	};
+
+	Frame frames[FRAME_LATENCY];
+	int current = 0;
+	std::vector<GLuint> pool;
+
+	GLuint acquire()
+	{
+		if (pool.empty())
+		{
+			pool.resize(16);
+			glGenQueries((GLsizei)pool.size(), pool.data());
+		}
+		GLuint query = pool.back();
+		pool.pop_back();
+		return query;
+	}
+
+	void release(Frame &frame)
+	{
+		for (const Pass &pass : frame.passes)
+		{
+			pool.push_back(pass.startQuery);
+			pool.push_back(pass.endQuery);
+		}
+		frame.passes.clear();
+		frame.open.clear();
+	}
+};
+
+// times the enclosing scope on the GPU
+class GpuZone
+{
+public:
+	GpuZone(GpuProfiler &profiler, const char *name) : profiler(profiler) { profiler.begin(name); }
+	~GpuZone() { profiler.end(); }
+
+	GpuZone(const GpuZone &) = delete;
+	GpuZone &operator=(const GpuZone &) = delete;
+
+private:
+	GpuProfiler &profiler;
+};
+
+#if PROFILER_ENABLED
+#define GPU_ZONE(profiler, name) GpuZone PROFILE_CONCAT(gpuZone, __LINE__)(profiler, name)
+#else
+#define GPU_ZONE(profiler, name) (void)0
+#endif
+#endif // !GPU_PROFILER_H
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Windowless OpenGL context for build/benchmark hosts without a GPU or display server.
+// Uses EGL on Linux, preferring Mesa's surfaceless platform so llvmpipe works without X/Wayland.
+// Nothing is presented, render into a Framebuffer instead of the default framebuffer.
+class HeadlessContext
+{
+public:
+	HeadlessContext() {}
+
+	~HeadlessContext()
+	{
+		destroy();
+	}
+
+	HeadlessContext(const HeadlessContext &) = delete;
+	HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+	// create a 3.3 core context and make it current, returns false when no EGL driver is usable
+	bool create(int majorVersion = 3, int minorVersion = 3)
+	{
+#if defined(__linux__)
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+		EGLint eglMajor = 0, eglMinor = 0;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+		{
+			spdlog::critical("Failed to initialize EGL display");
+			return false;
+		}
+		spdlog::info("EGL {}.{} vendor: {}", eglMajor, eglMinor, eglQueryString(display, EGL_VENDOR));
+
+		if (!eglBindAPI(EGL_OPENGL_API))
+		{
+			spdlog::critical("EGL implementation has no desktop OpenGL support");
+			return false;
+		}
+
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0)
+		{
+			// the surfaceless platform may expose configs without any surface type
+			const EGLint anyConfigAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+			if (!eglChooseConfig(display, anyConfigAttribs, &config, 1, &configCount) || configCount == 0)
+			{
+				spdlog::critical("No EGL config with OpenGL support");
+				return false;
+			}
+		}
+
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+			EGL_CONTEXT_MINOR_VERSION, minorVersion,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context == EGL_NO_CONTEXT)
+		{
+			spdlog::critical("Failed to create EGL OpenGL {}.{} core context", majorVersion, minorVersion);
+			return false;
+		}
+
+		// EGL_KHR_surfaceless_context lets us skip the pbuffer entirely, all drawing goes to FBOs
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+			surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+			if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context))
+			{
+				spdlog::critical("Failed to make EGL context current");
+				return false;
+			}
+		}
+		return true;
+#else
+		spdlog::critical("Headless rendering is only supported through EGL on Linux");
+		return false;
+#endif
+	}
+
+	// function loader for gladLoadGLLoader
+	static void *getProcAddress(const char *name)
+	{
+#if defined(__linux__)
+		return (void *)eglGetProcAddress(name);
+#else
+		return NULL;
+#endif
+	}
+
+	void destroy()
+	{
+#if defined(__linux__)
+		if (display == EGL_NO_DISPLAY)
+			return;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (surface != EGL_NO_SURFACE)
+			eglDestroySurface(display, surface);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		eglTerminate(display);
+		display = EGL_NO_DISPLAY;
+		surface = EGL_NO_SURFACE;
+		context = EGL_NO_CONTEXT;
+#endif
+	}
+
+private:
+#if defined(__linux__)
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLSurface surface = EGL_NO_SURFACE;
+	EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+#endif // !HEADLESS_CONTEXT_H
\ No newline at end of file
@@ -0,0 +1,166 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// per-instance texturing, two atlas regions as (scale.xy, offset.xy) and their page layers in layers.xy.
+// Three whole RGBA32F texels so the material buffer texture can be fetched per instance.
+struct InstanceMaterial
+{
+	glm::vec4 region1;
+	glm::vec4 region2;
+	glm::vec4 layers;
+};
+
+// Per-instance model matrices, and optionally an InstanceMaterial each, kept by slot in buffers the vertex
+// shader reads as buffer textures (texelFetch, four texels per matrix, three per material). What gets
+// drawn is picked by a separate stream of slot indices, a uint attribute that advances once per instance
+// (glVertexAttribDivisor). Culling only rewrites that stream, the slot data is patched when it changes.
+class InstanceBuffer
+{
+public:
+	// model matrix buffer id
+	unsigned int ID;
+	// number of instance slots allocated
+	GLsizei count = 0;
+
+	// attach the slot index stream to a vertex array at indexLocation, materials adds the material buffer
+	InstanceBuffer(unsigned int vao, GLuint indexLocation = 2, bool materials = false)
+		: indexLocation(indexLocation)
+	{
+		glGenBuffers(1, &ID);
+		glGenBuffers(1, &indexBuffer);
+		glGenTextures(1, &matrixTexture);
+		if (materials)
+		{
+			glGenBuffers(1, &materialBuffer);
+			glGenTextures(1, &materialTexture);
+		}
+		GLState::get().bindVertexArray(vao);
+		pointAttributes(0);
+		glEnableVertexAttribArray(indexLocation);
+		glVertexAttribDivisor(indexLocation, 1);
+		GLState::get().bindVertexArray(0);
+	}
+
+	~InstanceBuffer()
+	{
+		GLState &state = GLState::get();
+		for (unsigned int buffer : {ID, indexBuffer, materialBuffer})
+		{
+			if (!buffer)
+				continue;
+			state.forgetBuffer(buffer);
+			glDeleteBuffers(1, &buffer);
+		}
+		for (unsigned int texture : {matrixTexture, materialTexture})
+		{
+			if (!texture)
+				continue;
+			state.forgetTexture(texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+
+	InstanceBuffer(const InstanceBuffer &) = delete;
+	InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+	// size the slot stores once, then patch only the slots that changed with update() and updateMaterials().
+	// Nothing is orphaned, unchanged slots are never sent again. Fails when the matrices would not fit in
+	// one buffer texture, GL only guarantees 65536 texels and past the limit fetches read zeros.
+	bool allocate(size_t instanceCount)
+	{
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		if (instanceCount > (size_t)maxTexels / 4)
+		{
+			spdlog::error("{} instances need {} buffer texture texels, GL_MAX_TEXTURE_BUFFER_SIZE is {}", instanceCount, instanceCount * 4, maxTexels);
+			return false;
+		}
+
+		count = (GLsizei)instanceCount;
+		capacity = instanceCount;
+		GLState &state = GLState::get();
+		state.bindBuffer(GL_TEXTURE_BUFFER, ID);
+		glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+		state.bindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ID);
+		if (!materialBuffer)
+			return true;
+		state.bindBuffer(GL_TEXTURE_BUFFER, materialBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(InstanceMaterial), NULL, GL_DYNAMIC_DRAW);
+		state.bindTexture(GL_TEXTURE_BUFFER, materialTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, materialBuffer);
+		return true;
+	}
+
+	// overwrite slots [first, first + instanceCount) of an allocated store
+	void update(size_t first, const glm::mat4 *models, size_t instanceCount)
+	{
+		if (instanceCount == 0 || first + instanceCount > capacity)
+			return;
+		GLState::get().bindBuffer(GL_TEXTURE_BUFFER, ID);
+		glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(glm::mat4), instanceCount * sizeof(glm::mat4), models);
+	}
+
+	void updateMaterials(size_t first, const InstanceMaterial *materials, size_t instanceCount)
+	{
+		if (!materialBuffer || instanceCount == 0 || first + instanceCount > capacity)
+			return;
+		GLState::get().bindBuffer(GL_TEXTURE_BUFFER, materialBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(InstanceMaterial), instanceCount * sizeof(InstanceMaterial), materials);
+	}
+
+	// this frame's slots to draw, instance i of a draw with base instance b reads slot slots[b + i].
+	// The stream is orphaned so the driver never waits on last frame's draws.
+	void uploadIndices(const std::vector<uint32_t> &slots)
+	{
+		if (slots.empty())
+			return;
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+		if (slots.size() > indexCapacity)
+			indexCapacity = slots.size() + slots.size() / 2;
+		glBufferData(GL_ARRAY_BUFFER, indexCapacity * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, slots.size() * sizeof(uint32_t), slots.data());
+	}
+
+	// the slot stores on the texture units the shader's samplerBuffers are set to
+	void bindTextures(GLuint matrixUnit, GLuint materialUnit)
+	{
+		GLState::get().bindTexture(matrixUnit, GL_TEXTURE_BUFFER, matrixTexture);
+		if (materialTexture)
+			GLState::get().bindTexture(materialUnit, GL_TEXTURE_BUFFER, materialTexture);
+	}
+
+	// make instance 0 read index firstInstance, for draw calls that have no base instance parameter.
+	// The owning vertex array must be bound, rebase(0) restores the default.
+	void rebase(GLsizei firstInstance)
+	{
+		pointAttributes(firstInstance);
+	}
+
+private:
+	GLuint indexLocation;
+	unsigned int indexBuffer = 0;
+	unsigned int materialBuffer = 0;
+	unsigned int matrixTexture = 0;
+	unsigned int materialTexture = 0;
+	size_t capacity = 0;
+	size_t indexCapacity = 0;
+
+	// owning vertex array must be bound
+	void pointAttributes(GLsizei firstInstance)
+	{
+		GLState::get().bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+		glVertexAttribIPointer(indexLocation, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void *)((size_t)firstInstance * sizeof(uint32_t)));
+	}
+};
+#endif // !INSTANCE_BUFFER_H
\ No newline at end of file
@@ -0,0 +1,247 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "Profiler.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <algorithm>
+
+// one unit of work. unfinished counts the job itself plus children that have not completed yet,
+// a job is finished once it ran and all of its children are finished.
+struct Job
+{
+	std::function<void()> work;
+	std::shared_ptr<Job> parent;
+	std::atomic<int> unfinished{1};
+};
+typedef std::shared_ptr<Job> JobHandle;
+
+// Work stealing scheduler. Every worker owns a deque: it pushes and pops its own jobs at the back, idle
+// workers steal from the front of the others. Threads that are not workers (the render thread) share
+// one more deque and help out while they wait(). Frame work goes through run()/parallelFor(); long
+// blocking work goes through runBackground(), which only workers take so a waiting render thread never
+// picks up a file decode.
+class JobSystem
+{
+public:
+	// workerCount 0 leaves one core for the render thread
+	explicit JobSystem(unsigned int workerCount = 0)
+	{
+		if (workerCount == 0)
+			workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		for (unsigned int i = 0; i <= workerCount; i++)
+			queues.push_back(std::make_unique<WorkQueue>());
+		for (unsigned int i = 1; i <= workerCount; i++)
+			workers.emplace_back(&JobSystem::workerMain, this, i);
+	}
+
+	// queued jobs that have not started are dropped
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+
+	JobSystem(const JobSystem &) = delete;
+	JobSystem &operator=(const JobSystem &) = delete;
+
+	size_t workerCount() const { return workers.size(); }
+
+	// a job that is not queued yet, a parent is not finished before this job is
+	JobHandle create(std::function<void()> work, const JobHandle &parent = NULL)
+	{
+		JobHandle job = std::make_shared<Job>();
+		job->work = std::move(work);
+		if (parent)
+		{
+			parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+			job->parent = parent;
+		}
+		return job;
+	}
+
+	// frame work, pushed onto the calling thread's deque
+	void run(const JobHandle &job)
+	{
+		push(*queues[threadIndex()], job);
+	}
+
+	// blocking or long work, only worker threads take it and only when they have no frame work
+	void runBackground(const JobHandle &job)
+	{
+		push(background, job);
+	}
+
+	static bool finished(const JobHandle &job)
+	{
+		return job->unfinished.load(std::memory_order_acquire) == 0;
+	}
+
+	// run other frame jobs until job is finished
+	void wait(const JobHandle &job)
+	{
+		size_t index = threadIndex();
+		while (!finished(job))
+		{
+			JobHandle next = take(index, false);
+			if (next)
+				execute(next);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	// body(begin, end) over [0, count) in chunks of grain, the calling thread works too and it returns
+	// once every chunk ran. Chunk c starts at c * grain, so per-chunk outputs can be merged in order.
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body)
+	{
+		if (count == 0)
+			return;
+		grain = std::max<size_t>(1, grain);
+		if (count <= grain || workers.empty())
+		{
+			body(0, count);
+			return;
+		}
+
+		JobHandle root = create(NULL);
+		for (size_t begin = 0; begin < count; begin += grain)
+		{
+			size_t end = std::min(count, begin + grain);
+			run(create([&body, begin, end]() { body(begin, end); }, root));
+		}
+		execute(root);
+		wait(root);
+	}
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> queues; // 0 is shared by threads that are not workers
+	WorkQueue background;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queued{0};
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	struct ThreadSlot
+	{
+		const JobSystem *owner = NULL;
+		size_t index = 0;
+	};
+
+	static ThreadSlot &threadSlot()
+	{
+		thread_local ThreadSlot slot;
+		return slot;
+	}
+
+	size_t threadIndex() const
+	{
+		const ThreadSlot &slot = threadSlot();
+		return slot.owner == this ? slot.index : 0;
+	}
+
+	void push(WorkQueue &queue, const JobHandle &job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+		queued.fetch_add(1, std::memory_order_release);
+		// taking the sleep lock orders this push against a worker that is about to sleep
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+
+	// own deque newest first, then steal oldest first from the others, background work last
+	JobHandle take(size_t index, bool allowBackground)
+	{
+		if (queued.load(std::memory_order_acquire) == 0)
+			return NULL;
+
+		JobHandle job = popBack(*queues[index]);
+		for (size_t i = 1; !job && i < queues.size(); i++)
+			job = popFront(*queues[(index + i) % queues.size()]);
+		if (!job && allowBackground)
+			job = popFront(background);
+		if (job)
+			queued.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	static JobHandle popBack(WorkQueue &queue)
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return NULL;
+		JobHandle job = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+		return job;
+	}
+
+	static JobHandle popFront(WorkQueue &queue)
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return NULL;
+		JobHandle job = std::move(queue.jobs.front());
+		queue.jobs.pop_front();
+		return job;
+	}
+
+	static void execute(const JobHandle &job)
+	{
+		if (job->work)
+			job->work();
+		complete(job);
+	}
+
+	static void complete(JobHandle job)
+	{
+		while (job && job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			job = job->parent;
+	}
+
+	void workerMain(size_t index)
+	{
+		threadSlot() = {this, index};
+		PROFILE_THREAD_NAME("job worker " + std::to_string(index));
+
+		for (;;)
+		{
+			JobHandle job = take(index, true);
+			if (job)
+			{
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+			if (stopping)
+				return;
+		}
+	}
+};
+#endif // !JOB_SYSTEM_H
\ No newline at end of file
@@ -0,0 +1,272 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+
+// Minimal JSON document, enough for glTF headers. Lookups of missing keys or indices return a null value
+// so chained access like doc["meshes"][0]["primitives"] never needs checks in between.
+struct JsonValue
+{
+	enum Type
+	{
+		NUL,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	Type type = NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	bool isNull() const { return type == NUL; }
+	size_t size() const { return type == ARRAY ? array.size() : type == OBJECT ? object.size() : 0; }
+
+	double asNumber(double fallback = 0.0) const { return type == NUMBER ? number : fallback; }
+	int asInt(int fallback = 0) const { return type == NUMBER ? (int)number : fallback; }
+	bool asBool(bool fallback = false) const { return type == BOOLEAN ? boolean : fallback; }
+
+	const JsonValue &operator[](size_t index) const
+	{
+		return type == ARRAY && index < array.size() ? array[index] : null();
+	}
+
+	const JsonValue &operator[](const char *key) const
+	{
+		if (type == OBJECT)
+		{
+			for (const auto &member : object)
+			{
+				if (member.first == key)
+					return member.second;
+			}
+		}
+		return null();
+	}
+
+private:
+	static const JsonValue &null()
+	{
+		static const JsonValue value;
+		return value;
+	}
+};
+
+// recursive descent parser, returns false on malformed input
+class JsonParser
+{
+public:
+	static bool parse(const char *text, size_t length, JsonValue &out)
+	{
+		JsonParser parser(text, text + length);
+		parser.skipSpace();
+		if (!parser.parseValue(out, 0))
+			return false;
+		parser.skipSpace();
+		return parser.cursor == parser.end;
+	}
+
+private:
+	static const int MAX_DEPTH = 64;
+
+	const char *cursor;
+	const char *end;
+
+	JsonParser(const char *begin, const char *end) : cursor(begin), end(end) {}
+
+	void skipSpace()
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+			cursor++;
+	}
+
+	bool literal(const char *word)
+	{
+		size_t length = std::strlen(word);
+		if ((size_t)(end - cursor) < length || std::memcmp(cursor, word, length) != 0)
+			return false;
+		cursor += length;
+		return true;
+	}
+
+	bool parseValue(JsonValue &out, int depth)
+	{
+		if (cursor >= end || depth > MAX_DEPTH)
+			return false;
+		switch (*cursor)
+		{
+		case '{':
+			return parseObject(out, depth);
+		case '[':
+			return parseArray(out, depth);
+		case '"':
+			out.type = JsonValue::STRING;
+			return parseString(out.string);
+		case 't':
+			out.type = JsonValue::BOOLEAN;
+			out.boolean = true;
+			return literal("true");
+		case 'f':
+			out.type = JsonValue::BOOLEAN;
+			return literal("false");
+		case 'n':
+			return literal("null");
+		default:
+			return parseNumber(out);
+		}
+	}
+
+	bool parseNumber(JsonValue &out)
+	{
+		// strtod needs a terminator, copy the token out
+		const char *start = cursor;
+		while (cursor < end && (std::strchr("+-0123456789.eE", *cursor) != NULL))
+			cursor++;
+		if (cursor == start)
+			return false;
+		std::string token(start, cursor);
+		char *parsedEnd = NULL;
+		out.type = JsonValue::NUMBER;
+		out.number = std::strtod(token.c_str(), &parsedEnd);
+		return parsedEnd == token.c_str() + token.size();
+	}
+
+	bool parseString(std::string &out)
+	{
+		cursor++; // opening quote
+		while (cursor < end && *cursor != '"')
+		{
+			char c = *cursor++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (cursor >= end)
+				return false;
+			char escaped = *cursor++;
+			switch (escaped)
+			{
+			case 'n':
+				out += '\n';
+				break;
+			case 't':
+				out += '\t';
+				break;
+			case 'r':
+				out += '\r';
+				break;
+			case 'b':
+				out += '\b';
+				break;
+			case 'f':
+				out += '\f';
+				break;
+			case 'u':
+			{
+				// encode the code point as UTF-8, surrogate pairs are not combined
+				if (end - cursor < 4)
+					return false;
+				unsigned int code = (unsigned int)std::strtoul(std::string(cursor, cursor + 4).c_str(), NULL, 16);
+				cursor += 4;
+				if (code < 0x80)
+					out += (char)code;
+				else if (code < 0x800)
+				{
+					out += (char)(0xC0 | (code >> 6));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					out += (char)(0xE0 | (code >> 12));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				break;
+			}
+			default:
+				out += escaped; // \" \\ \/
+			}
+		}
+		if (cursor >= end)
+			return false;
+		cursor++; // closing quote
+		return true;
+	}
+
+	bool parseArray(JsonValue &out, int depth)
+	{
+		out.type = JsonValue::ARRAY;
+		cursor++;
+		skipSpace();
+		if (cursor < end && *cursor == ']')
+		{
+			cursor++;
+			return true;
+		}
+		for (;;)
+		{
+			out.array.emplace_back();
+			skipSpace();
+			if (!parseValue(out.array.back(), depth + 1))
+				return false;
+			skipSpace();
+			if (cursor >= end)
+				return false;
+			if (*cursor == ']')
+			{
+				cursor++;
+				return true;
+			}
+			if (*cursor++ != ',')
+				return false;
+		}
+	}
+
+	bool parseObject(JsonValue &out, int depth)
+	{
+		out.type = JsonValue::OBJECT;
+		cursor++;
+		skipSpace();
+		if (cursor < end && *cursor == '}')
+		{
+			cursor++;
+			return true;
+		}
+		for (;;)
+		{
+			skipSpace();
+			if (cursor >= end || *cursor != '"')
+				return false;
+			out.object.emplace_back();
+			if (!parseString(out.object.back().first))
+				return false;
+			skipSpace();
+			if (cursor >= end || *cursor++ != ':')
+				return false;
+			skipSpace();
+			if (!parseValue(out.object.back().second, depth + 1))
+				return false;
+			skipSpace();
+			if (cursor >= end)
+				return false;
+			if (*cursor == '}')
+			{
+				cursor++;
+				return true;
+			}
+			if (*cursor++ != ',')
+				return false;
+		}
+	}
+};
+#endif // !JSON_H
\ No newline at end of file
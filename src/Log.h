@@ -0,0 +1,128 @@
+#ifndef LOG_H
+#define LOG_H
+
+// SPDLOG_DEBUG/SPDLOG_TRACE calls below this level compile to nothing, it has to be set before spdlog is
+// first included so this header goes first in main.cpp. Override with -DSPDLOG_ACTIVE_LEVEL=...
+#ifndef SPDLOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#else
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
+#endif
+#endif
+
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+// Routes the default logger through spdlog's async logger for the lifetime of the object: callers only
+// format and enqueue, a background thread does the console I/O. The queue is bounded and overruns its
+// oldest entries when full, so a burst of messages drops old lines instead of stalling the render thread.
+class AsyncLogging
+{
+public:
+	explicit AsyncLogging(size_t queueSize = 8192)
+	{
+		spdlog::init_thread_pool(queueSize, 1);
+		auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+		auto logger = std::make_shared<spdlog::async_logger>("renderer", sink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+		spdlog::set_default_logger(logger);
+		// errors usually come right before an exit, don't leave them in the queue
+		spdlog::flush_on(spdlog::level::err);
+	}
+
+	// drain the queue and join the logging thread before statics go away
+	~AsyncLogging()
+	{
+		spdlog::shutdown();
+	}
+
+	AsyncLogging(const AsyncLogging &) = delete;
+	AsyncLogging &operator=(const AsyncLogging &) = delete;
+};
+
+// Per category token bucket: up to burst messages at once, refilled at ratePerSecond. Dropped messages
+// are counted and reported by the next one that gets through.
+class LogRateLimiter
+{
+public:
+	static LogRateLimiter &get()
+	{
+		static LogRateLimiter limiter;
+		return limiter;
+	}
+
+	void setLimit(const std::string &category, double ratePerSecond, double burst)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Bucket &bucket = buckets[category];
+		bucket.rate = ratePerSecond;
+		bucket.burst = burst;
+		bucket.tokens = burst;
+	}
+
+	// true when a message of category may be logged now, suppressed receives how many were dropped before it
+	bool allow(const char *category, size_t &suppressed)
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::lock_guard<std::mutex> lock(mutex);
+		Bucket &bucket = buckets[category];
+		if (bucket.last != std::chrono::steady_clock::time_point())
+		{
+			double elapsed = std::chrono::duration<double>(now - bucket.last).count();
+			bucket.tokens = std::min(bucket.burst, bucket.tokens + elapsed * bucket.rate);
+		}
+		bucket.last = now;
+
+		if (bucket.tokens < 1.0)
+		{
+			bucket.suppressed++;
+			return false;
+		}
+		bucket.tokens -= 1.0;
+		suppressed = bucket.suppressed;
+		bucket.suppressed = 0;
+		return true;
+	}
+
+private:
+	struct Bucket
+	{
+		double rate = 10.0;
+		double burst = 10.0;
+		double tokens = 10.0;
+		size_t suppressed = 0;
+		std::chrono::steady_clock::time_point last;
+	};
+
+	std::mutex mutex;
+	std::map<std::string, Bucket> buckets;
+};
+
+// LOG_LIMITED(category, level, fmt, args...): level is checked first, so a filtered level costs no lock
+#define LOG_LIMITED(category, level, ...)                                                                  \
+	do                                                                                                     \
+	{                                                                                                      \
+		size_t logSuppressed = 0;                                                                          \
+		if (spdlog::should_log(level) && LogRateLimiter::get().allow(category, logSuppressed))             \
+		{                                                                                                  \
+			if (logSuppressed > 0)                                                                         \
+				spdlog::log(level, "({} {} messages suppressed)", logSuppressed, category);                \
+			spdlog::log(level, __VA_ARGS__);                                                               \
+		}                                                                                                  \
+	} while (0)
+
+// rate limited debug logging that is also stripped at compile time with SPDLOG_ACTIVE_LEVEL
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define LOG_LIMITED_DEBUG(category, ...) LOG_LIMITED(category, spdlog::level::debug, __VA_ARGS__)
+#else
+#define LOG_LIMITED_DEBUG(category, ...) (void)0
+#endif
+#endif // !LOG_H
\ No newline at end of file
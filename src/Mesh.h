@@ -0,0 +1,271 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <spdlog/spdlog.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Indexed triangle list with interleaved float vertices, stride floats per vertex
+struct MeshData
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	int stride = 0;
+
+	size_t vertexCount() const { return stride > 0 ? vertices.size() / stride : 0; }
+};
+
+// merge bitwise identical vertices of a non-indexed triangle list and build the index buffer
+inline MeshData weldVertices(const float *vertices, size_t vertexCount, int stride)
+{
+	MeshData mesh;
+	mesh.stride = stride;
+	mesh.indices.resize(vertexCount);
+	mesh.vertices.reserve(vertexCount * stride);
+
+	const size_t vertexBytes = stride * sizeof(float);
+	auto hashVertex = [vertexBytes](const float *v) {
+		// FNV-1a over the raw bytes, so -0.0 and 0.0 count as different vertices
+		const unsigned char *bytes = (const unsigned char *)v;
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < vertexBytes; i++)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	};
+
+	// open addressing table of welded vertex indices, at most half full
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, ~0u);
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float *v = vertices + i * stride;
+		size_t slot = hashVertex(v) & (tableSize - 1);
+		while (table[slot] != ~0u && std::memcmp(&mesh.vertices[(size_t)table[slot] * stride], v, vertexBytes) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == ~0u)
+		{
+			table[slot] = (unsigned int)mesh.vertexCount();
+			mesh.vertices.insert(mesh.vertices.end(), v, v + stride);
+		}
+		mesh.indices[i] = table[slot];
+	}
+	return mesh;
+}
+
+// average cache miss ratio: transformed vertices per triangle through a FIFO post-transform cache,
+// 3.0 is no reuse at all, 0.5 is the limit for large regular meshes
+inline float computeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// a vertex is cached when fewer than cacheSize misses happened since it was inserted
+	std::vector<unsigned int> insertedAt(vertexCount, 0);
+	std::vector<bool> seen(vertexCount, false);
+	unsigned int misses = 0;
+	for (unsigned int index : indices)
+	{
+		if (seen[index] && misses - insertedAt[index] < cacheSize)
+			continue;
+		seen[index] = true;
+		insertedAt[index] = misses;
+		misses++;
+	}
+	return (float)misses / (indices.size() / 3);
+}
+
+// Reorder triangles for post-transform vertex cache reuse, Tom Forsyth's linear-speed greedy method:
+// every vertex scores by its position in a simulated LRU cache plus a boost for few remaining
+// triangles, the next triangle emitted is the one with the highest summed score
+inline void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount)
+{
+	static const int CACHE_SIZE = 32;
+	static const float CACHE_DECAY_POWER = 1.5f;
+	static const float LAST_TRIANGLE_SCORE = 0.75f;
+	static const float VALENCE_BOOST_SCALE = 2.0f;
+	static const float VALENCE_BOOST_POWER = 0.5f;
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	auto vertexScore = [](int cachePosition, unsigned int remaining) {
+		if (remaining == 0)
+			return -1.0f;
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE; // used by the last triangle, fixed so it does not favour one winding
+			else
+				score = std::pow(1.0f - (cachePosition - 3) * (1.0f / (CACHE_SIZE - 3)), CACHE_DECAY_POWER);
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+	};
+
+	// vertex -> triangle adjacency, compacted as triangles get emitted
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices)
+		remaining[index]++;
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	std::vector<unsigned int> cache, nextCache;
+	cache.reserve(CACHE_SIZE + 3);
+	nextCache.reserve(CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+	long best = -1;
+	while (output.size() < indices.size())
+	{
+		if (best < 0)
+		{
+			// nothing adjacent to the cache left, restart from the best unemitted triangle in order
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+			if (scanCursor == triangleCount)
+				break;
+			best = (long)scanCursor;
+			for (size_t t = scanCursor; t < triangleCount && t < scanCursor + 64; t++)
+			{
+				if (!emitted[t] && triangleScore[t] > triangleScore[best])
+					best = (long)t;
+			}
+		}
+
+		const unsigned int *tri = &indices[(size_t)best * 3];
+		emitted[best] = true;
+		output.insert(output.end(), tri, tri + 3);
+
+		// drop the triangle from its vertices' adjacency
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int *begin = &adjacency[adjacencyStart[v]];
+			unsigned int *end = begin + remaining[v];
+			*std::find(begin, end, (unsigned int)best) = *(end - 1);
+			remaining[v]--;
+		}
+
+		// move its vertices to the front of the LRU cache, the rest shift back
+		nextCache.assign(tri, tri + 3);
+		for (unsigned int v : cache)
+		{
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				nextCache.push_back(v);
+		}
+		cache.swap(nextCache);
+
+		// rescore everything that was or is in the cache, the triangles next to the cache compete for the next pick
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			cachePosition[v] = i < (size_t)CACHE_SIZE ? (int)i : -1;
+			float updated = vertexScore(cachePosition[v], remaining[v]);
+			float delta = updated - score[v];
+			score[v] = updated;
+			for (size_t a = adjacencyStart[v]; a < adjacencyStart[v] + remaining[v]; a++)
+				triangleScore[adjacency[a]] += delta;
+		}
+		if (cache.size() > (size_t)CACHE_SIZE)
+			cache.resize(CACHE_SIZE);
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			for (size_t a = adjacencyStart[v]; a < adjacencyStart[v] + remaining[v]; a++)
+			{
+				unsigned int t = adjacency[a];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = (long)t;
+				}
+			}
+		}
+	}
+	indices.swap(output);
+}
+
+// Reorder vertices by first use in the index buffer so vertex fetch walks memory mostly forward,
+// run after optimizeVertexCache. Unreferenced vertices are dropped.
+inline void optimizeVertexFetch(MeshData &mesh)
+{
+	const size_t vertexCount = mesh.vertexCount();
+	std::vector<unsigned int> remap(vertexCount, ~0u);
+	std::vector<float> reordered;
+	reordered.reserve(mesh.vertices.size());
+	for (unsigned int &index : mesh.indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = (unsigned int)(reordered.size() / mesh.stride);
+			const float *v = &mesh.vertices[(size_t)index * mesh.stride];
+			reordered.insert(reordered.end(), v, v + mesh.stride);
+		}
+		index = remap[index];
+	}
+	mesh.vertices.swap(reordered);
+}
+
+// reorder an indexed mesh for the vertex cache and for fetch locality, logging the ACMR change
+inline void optimizeMesh(const char *name, MeshData &mesh)
+{
+	float before = computeACMR(mesh.indices, mesh.vertexCount());
+	optimizeVertexCache(mesh.indices, mesh.vertexCount());
+	optimizeVertexFetch(mesh);
+	spdlog::info("Mesh {}: {} vertices, {} triangles, ACMR {:.3f} -> {:.3f}",
+		name, mesh.vertexCount(), mesh.indices.size() / 3, before, computeACMR(mesh.indices, mesh.vertexCount()));
+}
+
+// weld a non-indexed triangle list, then optimize it
+inline MeshData buildIndexedMesh(const char *name, const float *vertices, size_t vertexCount, int stride)
+{
+	MeshData mesh = weldVertices(vertices, vertexCount, stride);
+	spdlog::info("Mesh {}: welded {} -> {} vertices ({} -> {} bytes)", name, vertexCount, mesh.vertexCount(),
+		vertexCount * stride * sizeof(float), mesh.vertices.size() * sizeof(float) + mesh.indices.size() * sizeof(unsigned int));
+	optimizeMesh(name, mesh);
+	return mesh;
+}
+
+// distance of the farthest vertex from the origin, positions are the first three floats of a vertex
+inline float meshBoundingRadius(const MeshData &mesh)
+{
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i + 2 < mesh.vertices.size(); i += mesh.stride)
+	{
+		const float *p = &mesh.vertices[i];
+		radiusSquared = std::max(radiusSquared, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+	}
+	return std::sqrt(radiusSquared);
+}
+#endif // !MESH_H
\ No newline at end of file
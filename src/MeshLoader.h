@@ -0,0 +1,633 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <spdlog/spdlog.h>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "Json.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <climits>
+
+// Mesh importer for Wavefront OBJ and binary glTF 2.0 (.glb). The file is memory mapped and parsed on
+// several threads straight into the interleaved layout the renderer uploads: position xyz, uv, stride 5.
+class MeshLoader
+{
+public:
+	static const int STRIDE = 5;
+
+	explicit MeshLoader(unsigned int threadCount = 0) : threadCount(threadCount)
+	{
+		if (this->threadCount == 0)
+			this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// picks the format from the extension, logs load throughput
+	bool load(const std::string &path, MeshData &mesh)
+	{
+		auto start = std::chrono::steady_clock::now();
+		MappedFile file;
+		if (!file.open(path))
+		{
+			spdlog::error("Failed to open mesh file {}", path);
+			return false;
+		}
+		file.prefetch();
+
+		std::string extension = std::filesystem::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		mesh = MeshData();
+		mesh.stride = STRIDE;
+		bool loaded = false;
+		if (extension == ".obj")
+			loaded = loadObj(file, mesh);
+		else if (extension == ".glb")
+			loaded = loadGlb(file, mesh);
+		else
+			spdlog::error("Unsupported mesh format {}, expected .obj or .glb", path);
+		if (!loaded)
+		{
+			spdlog::error("Failed to load mesh {}", path);
+			return false;
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double megabytes = file.size() / (1024.0 * 1024.0);
+		spdlog::info("Loaded mesh {}: {} vertices, {} triangles, {:.1f} MB in {:.1f} ms ({:.1f} MB/s, {} threads)",
+			path, mesh.vertexCount(), mesh.indices.size() / 3, megabytes, seconds * 1000.0, megabytes / std::max(seconds, 1e-9), threadCount);
+		return true;
+	}
+
+private:
+	unsigned int threadCount;
+
+	// run fn(i) for i in [0, count) on up to threadCount threads, the calling thread takes part
+	template <typename Fn>
+	void parallelFor(size_t count, Fn fn)
+	{
+		std::atomic<size_t> next{0};
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++)
+				fn(i);
+		};
+		std::vector<std::thread> threads;
+		for (unsigned int t = 1; t < std::min<size_t>(threadCount, count); t++)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	// ---- OBJ ----
+
+	// corner references are global 0-based indices, relative OBJ references are stored as a chunk local
+	// index minus RELATIVE (always negative, the local index can point into earlier chunks) and are
+	// rebased once the chunk offsets are known
+	static const int32_t RELATIVE = 1 << 30;
+	static const int32_t NO_UV = INT32_MIN;
+
+	struct ObjChunk
+	{
+		const char *begin, *end;
+		std::vector<float> positions; // xyz
+		std::vector<float> uvs;		  // uv
+		std::vector<int32_t> corners; // position, uv pairs, three per triangle
+		size_t positionBase = 0, uvBase = 0;
+		bool badReference = false; // a face referenced vertex 0 or beyond what RELATIVE can encode
+	};
+
+	bool loadObj(const MappedFile &file, MeshData &mesh)
+	{
+		const char *text = (const char *)file.data();
+		const char *textEnd = text + file.size();
+
+		// split at line boundaries, small files are not worth the threads
+		size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 4, file.size() / (256 * 1024)));
+		std::vector<ObjChunk> chunks(chunkCount);
+		const char *cursor = text;
+		for (size_t c = 0; c < chunkCount; c++)
+		{
+			const char *chunkEnd = c + 1 == chunkCount ? textEnd : std::max(cursor, text + file.size() * (c + 1) / chunkCount);
+			while (chunkEnd < textEnd && chunkEnd[-1] != '\n')
+				chunkEnd++;
+			chunks[c].begin = cursor;
+			chunks[c].end = chunkEnd;
+			cursor = chunkEnd;
+		}
+
+		parallelFor(chunkCount, [&](size_t c) { parseObjChunk(chunks[c]); });
+		for (const ObjChunk &chunk : chunks)
+		{
+			if (chunk.badReference)
+			{
+				spdlog::error("OBJ face references vertex 0 or an index too large to load");
+				return false;
+			}
+		}
+
+		size_t positionCount = 0, uvCount = 0, cornerCount = 0;
+		for (ObjChunk &chunk : chunks)
+		{
+			chunk.positionBase = positionCount;
+			chunk.uvBase = uvCount;
+			positionCount += chunk.positions.size() / 3;
+			uvCount += chunk.uvs.size() / 2;
+			cornerCount += chunk.corners.size() / 2;
+		}
+		if (cornerCount == 0)
+		{
+			spdlog::error("OBJ file has no faces");
+			return false;
+		}
+
+		// rebase relative references and validate against the final counts
+		std::atomic<bool> valid{true};
+		parallelFor(chunkCount, [&](size_t c) {
+			ObjChunk &chunk = chunks[c];
+			for (size_t i = 0; i < chunk.corners.size(); i += 2)
+			{
+				int32_t &p = chunk.corners[i];
+				int32_t &t = chunk.corners[i + 1];
+				if (p < 0)
+					p = (int32_t)chunk.positionBase + (p + RELATIVE);
+				if (t != NO_UV && t < 0)
+					t = (int32_t)chunk.uvBase + (t + RELATIVE);
+				if (p < 0 || (size_t)p >= positionCount || (t != NO_UV && (t < 0 || (size_t)t >= uvCount)))
+					valid = false;
+			}
+		});
+		if (!valid)
+		{
+			spdlog::error("OBJ face references a vertex out of range");
+			return false;
+		}
+
+		// unique position/uv pairs become vertices, written straight into the interleaved buffer
+		size_t tableSize = 1;
+		while (tableSize < cornerCount * 2)
+			tableSize *= 2;
+		std::vector<uint64_t> keys(tableSize);
+		std::vector<uint32_t> slots(tableSize, ~0u);
+		mesh.indices.resize(cornerCount);
+		mesh.vertices.reserve(std::max(positionCount, uvCount) * STRIDE);
+		size_t corner = 0;
+		for (const ObjChunk &chunk : chunks)
+		{
+			for (size_t i = 0; i < chunk.corners.size(); i += 2)
+			{
+				uint32_t p = (uint32_t)chunk.corners[i];
+				uint32_t t = (uint32_t)chunk.corners[i + 1];
+				uint64_t key = ((uint64_t)p << 32) | t;
+				size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (tableSize - 1);
+				while (slots[slot] != ~0u && keys[slot] != key)
+					slot = (slot + 1) & (tableSize - 1);
+				if (slots[slot] == ~0u)
+				{
+					keys[slot] = key;
+					slots[slot] = (uint32_t)mesh.vertexCount();
+					const float *position = &positionAt(chunks, p);
+					mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+					if (chunk.corners[i + 1] == NO_UV)
+					{
+						mesh.vertices.push_back(0.0f);
+						mesh.vertices.push_back(0.0f);
+					}
+					else
+					{
+						const float *uv = &uvAt(chunks, t);
+						mesh.vertices.insert(mesh.vertices.end(), uv, uv + 2);
+					}
+				}
+				mesh.indices[corner++] = slots[slot];
+			}
+		}
+		return true;
+	}
+
+	// global index -> chunk storage, the last chunk whose base is not past the index owns it
+	static const float &positionAt(const std::vector<ObjChunk> &chunks, size_t index)
+	{
+		auto owner = std::upper_bound(chunks.begin(), chunks.end(), index, [](size_t i, const ObjChunk &chunk) { return i < chunk.positionBase; }) - 1;
+		return owner->positions[(index - owner->positionBase) * 3];
+	}
+	static const float &uvAt(const std::vector<ObjChunk> &chunks, size_t index)
+	{
+		auto owner = std::upper_bound(chunks.begin(), chunks.end(), index, [](size_t i, const ObjChunk &chunk) { return i < chunk.uvBase; }) - 1;
+		return owner->uvs[(index - owner->uvBase) * 2];
+	}
+
+	static void parseObjChunk(ObjChunk &chunk)
+	{
+		const char *p = chunk.begin;
+		const char *end = chunk.end;
+		std::vector<int32_t> polygon;
+		while (p < end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t'))
+				p++;
+			if (end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				p += 2;
+				for (int i = 0; i < 3; i++)
+				{
+					float value = 0.0f;
+					p = parseFloat(p, end, value);
+					chunk.positions.push_back(value);
+				}
+			}
+			else if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+			{
+				p += 3;
+				for (int i = 0; i < 2; i++)
+				{
+					float value = 0.0f;
+					p = parseFloat(p, end, value);
+					chunk.uvs.push_back(value);
+				}
+			}
+			else if (end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				p += 2;
+				polygon.clear();
+				for (;;)
+				{
+					while (p < end && (*p == ' ' || *p == '\t'))
+						p++;
+					if (p >= end || *p == '\n' || *p == '\r' || *p == '#')
+						break;
+					int32_t position = 0, uv = NO_UV, normal = 0;
+					const char *token = p;
+					p = parseInt(p, end, position);
+					if (p == token)
+						break; // not a vertex reference, drop the rest of the line
+					if (p < end && *p == '/')
+					{
+						p++;
+						if (p < end && *p != '/')
+							p = parseInt(p, end, uv);
+						if (p < end && *p == '/')
+							p = parseInt(p + 1, end, normal); // normals are not used
+					}
+					int32_t resolvedPosition = 0, resolvedUV = NO_UV;
+					if (!resolve(position, chunk.positions.size() / 3, resolvedPosition) ||
+						(uv != NO_UV && !resolve(uv, chunk.uvs.size() / 2, resolvedUV)))
+					{
+						chunk.badReference = true;
+						return;
+					}
+					polygon.push_back(resolvedPosition);
+					polygon.push_back(resolvedUV);
+				}
+				// fan triangulation
+				for (size_t i = 4; i + 1 < polygon.size(); i += 2)
+				{
+					chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.begin() + 2);
+					chunk.corners.insert(chunk.corners.end(), polygon.begin() + i - 2, polygon.begin() + i + 2);
+				}
+			}
+			// anything else (normals, groups, materials, comments) is skipped
+			while (p < end && *p != '\n')
+				p++;
+			p++;
+		}
+	}
+
+	// OBJ references are 1-based, negative ones count back from the last vertex read so far. 0 is not a
+	// reference, and magnitudes from RELATIVE up cannot be told apart from the relative encoding.
+	static bool resolve(int32_t reference, size_t localCount, int32_t &out)
+	{
+		if (reference == 0 || reference >= RELATIVE || reference <= -RELATIVE || localCount >= (size_t)RELATIVE)
+			return false;
+		out = reference > 0 ? reference - 1 : (int32_t)localCount + reference - RELATIVE;
+		return true;
+	}
+
+	// saturates at +-INT32_MAX, so a huge value never wraps and never lands on NO_UV
+	static const char *parseInt(const char *p, const char *end, int32_t &out)
+	{
+		bool negative = p < end && *p == '-';
+		if (negative || (p < end && *p == '+'))
+			p++;
+		int64_t value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+			value = std::min<int64_t>(value * 10 + (*p++ - '0'), INT32_MAX);
+		out = (int32_t)(negative ? -value : value);
+		return p;
+	}
+
+	// locale independent and much faster than strtof, exact enough for vertex data
+	static const char *parseFloat(const char *p, const char *end, float &out)
+	{
+		static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		bool negative = p < end && *p == '-';
+		if (negative || (p < end && *p == '+'))
+			p++;
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if (digits++ < 18)
+				mantissa = mantissa * 10 + (*p - '0');
+			else
+				exponent++;
+		}
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+			{
+				if (digits++ < 18)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			int32_t e = 0;
+			p = parseInt(p + 1, end, e);
+			exponent += e;
+		}
+		double value = (double)mantissa;
+		while (exponent > 18)
+		{
+			value *= 1e18;
+			exponent -= 18;
+		}
+		while (exponent < -18)
+		{
+			value /= 1e18;
+			exponent += 18;
+		}
+		value = exponent >= 0 ? value * powers[exponent] : value / powers[-exponent];
+		out = (float)(negative ? -value : value);
+		return p;
+	}
+
+	// ---- glTF binary ----
+
+	struct Accessor
+	{
+		const unsigned char *data = NULL;
+		size_t count = 0;
+		size_t stride = 0;
+		int componentType = 0;
+		int components = 0;
+		bool normalized = false;
+
+		float component(size_t element, int c) const
+		{
+			const unsigned char *p = data + element * stride;
+			switch (componentType)
+			{
+			case 5126: // float
+			{
+				float value;
+				std::memcpy(&value, p + c * 4, 4);
+				return value;
+			}
+			case 5121: // unsigned byte
+				return normalized ? p[c] / 255.0f : p[c];
+			case 5123: // unsigned short
+			{
+				uint16_t value;
+				std::memcpy(&value, p + c * 2, 2);
+				return normalized ? value / 65535.0f : value;
+			}
+			default:
+				return 0.0f;
+			}
+		}
+
+		uint32_t index(size_t element) const
+		{
+			const unsigned char *p = data + element * stride;
+			if (componentType == 5121)
+				return *p;
+			if (componentType == 5123)
+			{
+				uint16_t value;
+				std::memcpy(&value, p, 2);
+				return value;
+			}
+			uint32_t value;
+			std::memcpy(&value, p, 4);
+			return value;
+		}
+	};
+
+	struct Primitive
+	{
+		Accessor positions, uvs, indices;
+		bool hasUvs = false, hasIndices = false;
+		size_t vertexBase = 0, indexBase = 0;
+	};
+
+	// a slice of one primitive's vertices or indices, the unit of parallel work
+	struct Range
+	{
+		size_t primitive;
+		bool indices;
+		size_t begin, end;
+	};
+
+	static bool readAccessor(const JsonValue &doc, const JsonValue &index, const unsigned char *bin, size_t binSize, Accessor &out)
+	{
+		const JsonValue &accessor = doc["accessors"][(size_t)index.asInt(-1)];
+		if (accessor.isNull() || !accessor["sparse"].isNull())
+			return false;
+		const JsonValue &view = doc["bufferViews"][(size_t)accessor["bufferView"].asInt(-1)];
+		if (view.isNull() || view["buffer"].asInt(0) != 0)
+			return false;
+
+		static const std::pair<const char *, int> types[] = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}};
+		out.components = 0;
+		for (const auto &type : types)
+		{
+			if (accessor["type"].string == type.first)
+				out.components = type.second;
+		}
+		out.componentType = accessor["componentType"].asInt();
+		size_t componentSize = out.componentType == 5126 || out.componentType == 5125 ? 4 : out.componentType == 5123 || out.componentType == 5122 ? 2 : 1;
+		size_t elementSize = componentSize * out.components;
+		out.normalized = accessor["normalized"].asBool();
+		size_t viewOffset, viewLength, accessorOffset;
+		if (out.components == 0 || !readSize(accessor["count"], 0.0, out.count) || !readSize(view["byteStride"], (double)elementSize, out.stride) ||
+			!readSize(view["byteOffset"], 0.0, viewOffset) || !readSize(view["byteLength"], 0.0, viewLength) || !readSize(accessor["byteOffset"], 0.0, accessorOffset))
+			return false;
+
+		// every step is checked before it is added so nothing can wrap around
+		if (out.count == 0 || out.stride < elementSize || viewOffset > binSize || viewLength > binSize - viewOffset)
+			return false;
+		size_t viewEnd = viewOffset + viewLength;
+		if (accessorOffset > viewLength)
+			return false;
+		size_t offset = viewOffset + accessorOffset;
+		if (elementSize > viewEnd - offset || out.count > (viewEnd - offset - elementSize) / out.stride + 1)
+			return false;
+		out.data = bin + offset;
+		return true;
+	}
+
+	// non-negative integral JSON number that fits a size_t, missing values take fallback
+	static bool readSize(const JsonValue &value, double fallback, size_t &out)
+	{
+		double number = value.asNumber(fallback);
+		if (!(number >= 0.0 && number <= 9007199254740992.0) || number != (double)(uint64_t)number)
+			return false;
+		out = (size_t)number;
+		return true;
+	}
+
+	bool loadGlb(const MappedFile &file, MeshData &mesh)
+	{
+		const unsigned char *bytes = file.data();
+		uint32_t header[3];
+		if (file.size() < 20)
+			return false;
+		std::memcpy(header, bytes, sizeof(header));
+		if (header[0] != 0x46546C67 || header[1] != 2) // "glTF", version 2
+		{
+			spdlog::error("Not a glTF 2.0 binary file");
+			return false;
+		}
+
+		// JSON chunk first, optional BIN chunk after it
+		const char *json = NULL;
+		size_t jsonSize = 0;
+		const unsigned char *bin = NULL;
+		size_t binSize = 0;
+		size_t offset = 12;
+		size_t fileEnd = std::min<size_t>(file.size(), header[2]);
+		while (offset + 8 <= fileEnd)
+		{
+			uint32_t chunk[2];
+			std::memcpy(chunk, bytes + offset, sizeof(chunk));
+			offset += 8;
+			if (offset + chunk[0] > fileEnd)
+				return false;
+			if (chunk[1] == 0x4E4F534A && !json) // "JSON"
+			{
+				json = (const char *)bytes + offset;
+				jsonSize = chunk[0];
+			}
+			else if (chunk[1] == 0x004E4942 && !bin) // "BIN\0"
+			{
+				bin = bytes + offset;
+				binSize = chunk[0];
+			}
+			offset += (chunk[0] + 3) & ~3u;
+		}
+
+		JsonValue doc;
+		if (!json || !JsonParser::parse(json, jsonSize, doc))
+		{
+			spdlog::error("glTF JSON chunk missing or malformed");
+			return false;
+		}
+
+		// every triangle primitive of every mesh, node transforms are not applied
+		std::vector<Primitive> primitives;
+		size_t vertexCount = 0, indexCount = 0;
+		const JsonValue &meshes = doc["meshes"];
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			const JsonValue &list = meshes[m]["primitives"];
+			for (size_t p = 0; p < list.size(); p++)
+			{
+				const JsonValue &source = list[p];
+				if (source["mode"].asInt(4) != 4)
+					continue;
+				Primitive primitive;
+				const JsonValue &attributes = source["attributes"];
+				if (!readAccessor(doc, attributes["POSITION"], bin, binSize, primitive.positions) || primitive.positions.components != 3)
+				{
+					spdlog::error("glTF primitive {} of mesh {} has no usable POSITION", p, m);
+					return false;
+				}
+				if (!attributes["TEXCOORD_0"].isNull())
+				{
+					primitive.hasUvs = readAccessor(doc, attributes["TEXCOORD_0"], bin, binSize, primitive.uvs) &&
+									   primitive.uvs.count == primitive.positions.count && primitive.uvs.components == 2;
+				}
+				if (!source["indices"].isNull())
+				{
+					primitive.hasIndices = readAccessor(doc, source["indices"], bin, binSize, primitive.indices);
+					if (!primitive.hasIndices)
+						return false;
+				}
+				primitive.vertexBase = vertexCount;
+				primitive.indexBase = indexCount;
+				vertexCount += primitive.positions.count;
+				indexCount += primitive.hasIndices ? primitive.indices.count : primitive.positions.count;
+				primitives.push_back(primitive);
+			}
+		}
+		if (primitives.empty())
+		{
+			spdlog::error("glTF file has no triangle primitives");
+			return false;
+		}
+
+		// size the final buffers once, then every range writes its own slice of them
+		mesh.vertices.resize(vertexCount * STRIDE);
+		mesh.indices.resize(indexCount);
+		const size_t RANGE = 64 * 1024;
+		std::vector<Range> ranges;
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			const Primitive &primitive = primitives[p];
+			size_t indices = primitive.hasIndices ? primitive.indices.count : primitive.positions.count;
+			for (size_t begin = 0; begin < primitive.positions.count; begin += RANGE)
+				ranges.push_back({p, false, begin, std::min(begin + RANGE, primitive.positions.count)});
+			for (size_t begin = 0; begin < indices; begin += RANGE)
+				ranges.push_back({p, true, begin, std::min(begin + RANGE, indices)});
+		}
+
+		std::atomic<bool> valid{true};
+		parallelFor(ranges.size(), [&](size_t r) {
+			const Range &range = ranges[r];
+			const Primitive &primitive = primitives[range.primitive];
+			if (!range.indices)
+			{
+				float *out = &mesh.vertices[(primitive.vertexBase + range.begin) * STRIDE];
+				for (size_t v = range.begin; v < range.end; v++, out += STRIDE)
+				{
+					out[0] = primitive.positions.component(v, 0);
+					out[1] = primitive.positions.component(v, 1);
+					out[2] = primitive.positions.component(v, 2);
+					// glTF puts the uv origin top left, textures are flipped on load to the GL convention
+					out[3] = primitive.hasUvs ? primitive.uvs.component(v, 0) : 0.0f;
+					out[4] = primitive.hasUvs ? 1.0f - primitive.uvs.component(v, 1) : 0.0f;
+				}
+			}
+			else
+			{
+				unsigned int *out = &mesh.indices[primitive.indexBase + range.begin];
+				for (size_t i = range.begin; i < range.end; i++)
+				{
+					uint32_t index = primitive.hasIndices ? primitive.indices.index(i) : (uint32_t)i;
+					if (index >= primitive.positions.count)
+						valid = false;
+					*out++ = (unsigned int)(primitive.vertexBase + index);
+				}
+			}
+		});
+		if (!valid)
+			spdlog::error("glTF index out of range");
+		return valid;
+	}
+};
+#endif // !MESH_LOADER_H
\ No newline at end of file
@@ -0,0 +1,225 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <spdlog/spdlog.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+
+// build with PROFILER_ENABLED=0 to compile every zone out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// one finished zone, name must outlive the profiler (string literals, __func__)
+struct ProfileEvent
+{
+	const char *name;
+	uint64_t startNs;
+	uint64_t endNs;
+};
+
+// CPU zone profiler. Every thread records into its own ring buffer, only the owning thread writes and
+// publishes with a release store, so recording takes no lock. Old events are overwritten, a trace holds
+// the last RING_SIZE zones of every thread. Each slot carries the sequence number of the event in it, a
+// reader copying a slot the writer is rewriting sees the sequence change and drops the copy.
+class Profiler
+{
+public:
+	static const size_t RING_SIZE = 1 << 15;
+
+	static Profiler &get()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	// nanoseconds since the profiler was created
+	uint64_t now() const
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	void record(const char *name, uint64_t startNs, uint64_t endNs)
+	{
+		threadBuffer().push(name, startNs, endNs);
+	}
+
+	// record onto a named track that is not a thread, e.g. GPU timings converted to the profiler clock.
+	// A track must only be written from one thread.
+	void recordOnTrack(const char *track, const char *name, uint64_t startNs, uint64_t endNs)
+	{
+		ThreadBuffer *buffer;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = tracks.find(track);
+			if (it == tracks.end())
+				it = tracks.emplace(track, addBuffer(track)).first;
+			buffer = it->second;
+		}
+		buffer->push(name, startNs, endNs);
+	}
+
+	// label the calling thread in traces
+	void setThreadName(const std::string &name)
+	{
+		ThreadBuffer &buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(mutex);
+		buffer.name = name;
+	}
+
+	// Chrome trace event JSON, opens in chrome://tracing and Perfetto. Safe to call while other threads record.
+	bool writeChromeTrace(const std::string &path)
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			spdlog::error("Failed to open trace output {}", path);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+		size_t written = 0;
+		std::vector<ProfileEvent> events;
+		for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+		{
+			if (!first)
+				file << ",\n";
+			first = false;
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+				 << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+
+			// copy what was published, slots the writer lapped while we were copying are left out
+			uint64_t head = buffer->head.load(std::memory_order_acquire);
+			uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+			events.clear();
+			ProfileEvent copy;
+			for (uint64_t i = begin; i < head; i++)
+			{
+				if (buffer->read(i, copy))
+					events.push_back(copy);
+			}
+
+			for (const ProfileEvent &event : events)
+			{
+				file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+					 << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+				written++;
+			}
+		}
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		spdlog::info("Wrote {} profiler zones from {} threads to {}", written, buffers.size(), path);
+		return (bool)file;
+	}
+
+private:
+	// fields are atomics so a concurrent copy is not a data race, sequence is the event index + 1 and 0
+	// while the slot is being written
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence{0};
+		std::atomic<const char *> name{NULL};
+		std::atomic<uint64_t> startNs{0};
+		std::atomic<uint64_t> endNs{0};
+	};
+
+	struct ThreadBuffer
+	{
+		std::atomic<uint64_t> head{0};
+		int id = 0;
+		std::string name;
+		std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(RING_SIZE);
+
+		// owning thread only
+		void push(const char *eventName, uint64_t startNs, uint64_t endNs)
+		{
+			uint64_t index = head.load(std::memory_order_relaxed);
+			Slot &slot = slots[index & (RING_SIZE - 1)];
+			// release on the fields: a reader that sees any new field also sees the cleared sequence
+			slot.sequence.store(0, std::memory_order_relaxed);
+			slot.name.store(eventName, std::memory_order_release);
+			slot.startNs.store(startNs, std::memory_order_release);
+			slot.endNs.store(endNs, std::memory_order_release);
+			slot.sequence.store(index + 1, std::memory_order_release);
+			head.store(index + 1, std::memory_order_release);
+		}
+
+		// false when the slot no longer, or not yet, holds event index
+		bool read(uint64_t index, ProfileEvent &event) const
+		{
+			const Slot &slot = slots[index & (RING_SIZE - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+				return false;
+			event.name = slot.name.load(std::memory_order_acquire);
+			event.startNs = slot.startNs.load(std::memory_order_acquire);
+			event.endNs = slot.endNs.load(std::memory_order_acquire);
+			return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+		}
+	};
+
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::mutex mutex; // guards the buffer list and names, recording only takes it for a thread's first zone
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::map<std::string, ThreadBuffer *> tracks;
+
+	// mutex must be held
+	ThreadBuffer *addBuffer(const std::string &name)
+	{
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		ThreadBuffer *buffer = buffers.back().get();
+		buffer->id = (int)buffers.size();
+		buffer->name = name;
+		return buffer;
+	}
+
+	// buffers live as long as the profiler so a trace still shows threads that have exited
+	ThreadBuffer &threadBuffer()
+	{
+		thread_local ThreadBuffer *buffer = NULL;
+		if (!buffer)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			buffer = addBuffer("thread " + std::to_string(buffers.size() + 1));
+		}
+		return *buffer;
+	}
+};
+
+// records the enclosing scope
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char *name) : name(name), startNs(Profiler::get().now()) {}
+	~ProfileZone() { Profiler::get().record(name, startNs, Profiler::get().now()); }
+
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+	const char *name;
+	uint64_t startNs;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_THREAD_NAME(name) Profiler::get().setThreadName(name)
+#else
+#define PROFILE_ZONE(name) (void)0
+#define PROFILE_FUNCTION() (void)0
+#define PROFILE_THREAD_NAME(name) (void)0
+#endif
+#endif // !PROFILER_H
\ No newline at end of file
@@ -4,22 +4,249 @@
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
 
+#include "ShaderCompiler.h"
+#include "GLState.h"
+#include "Profiler.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <filesystem>
+#include <deque>
+#include <chrono>
+#include <thread>
 // #include <iostream>
 
+// uniform name hashed with FNV-1a, constexpr so literal names can be hashed at compile time
+struct UniformName
+{
+	uint32_t hash;
+
+	constexpr UniformName(const char *name) : hash(hashName(name)) {}
+	UniformName(const std::string &name) : hash(hashName(name.c_str())) {}
+
+	static constexpr uint32_t hashName(const char *name)
+	{
+		uint32_t h = 2166136261u;
+		while (*name)
+		{
+			h = (h ^ (uint8_t)*name++) * 16777619u;
+		}
+		return h;
+	}
+};
+
+// precomputed index into a shader's reflected uniform table
+struct UniformHandle
+{
+	int index = -1;
+
+	bool valid() const { return index >= 0; }
+};
+
 class Shader
 {
 public:
 	// shader program id
 	unsigned int ID;
 
-	// read and build shader
-	Shader(const char *vertexPath, const char *fragmentPath)
+	// tag for the constructor that only submits the build, see ShaderBatch
+	struct Deferred
+	{
+	};
+
+	// read and build shader, defines are injected after the #version line of both stages
+	Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines = "")
+		: Shader(vertexPath, fragmentPath, defines, Deferred())
+	{
+		finishBuild();
+	}
+
+	// hand the sources to the driver and return without waiting, ID is usable after finishBuild()
+	Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines, Deferred)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines)
+	{
+		PROFILE_ZONE("Shader submit");
+		std::string vertexCode;
+		std::string fragmentCode;
+		readSources(vertexCode, fragmentCode);
+
+		pending = ShaderCompiler::get().start(vertexCode, fragmentCode, defines);
+		ID = pending.program;
+		building = true;
+	}
+
+	Shader(const Shader &) = delete;
+	Shader &operator=(const Shader &) = delete;
+
+	// false while a deferred build is still compiling, never blocks
+	bool buildReady() const
+	{
+		return !building || ShaderCompiler::get().ready(pending);
+	}
+
+	// collect the result of the initial build, blocks if the driver is not done. Returns true when linked.
+	bool finishBuild()
 	{
+		if (!building)
+			return linked;
+		PROFILE_ZONE("Shader finish");
+		building = false;
+		linked = ShaderCompiler::get().finish(pending, name());
+		pending = ShaderCompiler::Build();
+		reflectUniforms();
+		return linked;
+	}
+
+	// start rebuilding from the source files, the current program stays in use until pollReload()
+	// swaps the new one in. A reload already in flight is dropped.
+	bool reload()
+	{
+		PROFILE_ZONE("Shader reload");
 		std::string vertexCode;
 		std::string fragmentCode;
+		if (!readSources(vertexCode, fragmentCode))
+			return false;
+
+		ShaderCompiler &compiler = ShaderCompiler::get();
+		if (reloading)
+			compiler.discard(pending);
+		pending = compiler.start(vertexCode, fragmentCode, defines);
+		reloading = true;
+		spdlog::info("Recompiling shader program {}", name());
+		return true;
+	}
+
+	// call once per frame, returns true when a successfully linked program replaced the old one.
+	// Uniform values and block bindings carry over, uniform handles have to be looked up again.
+	bool pollReload()
+	{
+		ShaderCompiler &compiler = ShaderCompiler::get();
+		if (!reloading || !compiler.ready(pending))
+			return false;
+
+		reloading = false;
+		if (!compiler.finish(pending, name()))
+		{
+			compiler.discard(pending);
+			spdlog::error("Keeping previous shader program {}", name());
+			return false;
+		}
+		PROFILE_ZONE("Shader swap");
+		adopt(pending.program);
+		pending = ShaderCompiler::Build();
+		linked = true;
+		spdlog::info("Reloaded shader program {}", name());
+		return true;
+	}
+
+	// true when path is one of the program's source files
+	bool usesFile(const std::string &path) const
+	{
+		std::error_code ec;
+		return std::filesystem::equivalent(path, vertexPath, ec) || std::filesystem::equivalent(path, fragmentPath, ec);
+	}
+
+	// on/off toggle;
+	void use()
+	{
+		GLState::get().useProgram(ID);
+	}
+
+	// look up a uniform once, keep the handle around for per-frame setters
+	UniformHandle uniform(UniformName name) const
+	{
+		UniformHandle handle;
+		handle.index = find(name.hash);
+		return handle;
+	}
+
+	// route a uniform block to a buffer binding point, GLSL 4.10 has no layout(binding) for blocks
+	bool bindUniformBlock(const char *blockName, GLuint binding)
+	{
+		GLuint index = glGetUniformBlockIndex(ID, blockName);
+		if (index == GL_INVALID_INDEX)
+			return false;
+		glUniformBlockBinding(ID, index, binding);
+		blockBindings.emplace_back(blockName, binding);
+		return true;
+	}
+
+	// utility uniform functions, uploads are skipped when the value matches the last one sent
+	void setBool(UniformHandle handle, bool value)
+	{
+		setInt(handle, (int)value);
+	}
+	void setInt(UniformHandle handle, int value)
+	{
+		if (changed(handle, value))
+			glUniform1i(uniforms[handle.index].location, value);
+	}
+	void setFloat(UniformHandle handle, float value)
+	{
+		if (changed(handle, value))
+			glUniform1f(uniforms[handle.index].location, value);
+	}
+	void setVec3(UniformHandle handle, const glm::vec3 &value)
+	{
+		if (changed(handle, value))
+			glUniform3fv(uniforms[handle.index].location, 1, glm::value_ptr(value));
+	}
+	void setMat4(UniformHandle handle, const glm::mat4 &value)
+	{
+		if (changed(handle, value))
+			glUniformMatrix4fv(uniforms[handle.index].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	// name based setters, still avoid glGetUniformLocation but pay for a table search
+	void setBool(UniformName name, bool value) { setBool(uniform(name), value); }
+	void setInt(UniformName name, int value) { setInt(uniform(name), value); }
+	void setFloat(UniformName name, float value) { setFloat(uniform(name), value); }
+	void setVec3(UniformName name, const glm::vec3 &value) { setVec3(uniform(name), value); }
+	void setMat4(UniformName name, const glm::mat4 &value) { setMat4(uniform(name), value); }
+
+private:
+	// reflected active uniform with a shadow copy of the last uploaded value
+	struct Uniform
+	{
+		uint32_t hash;
+		GLint location;
+		GLenum type;
+		GLint size;
+		std::string name;
+		bool cached = false;
+		alignas(16) unsigned char value[sizeof(glm::mat4)];
+	};
+
+	// sorted by name hash
+	std::vector<Uniform> uniforms;
+
+	// kept for reloads
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::string defines;
+	std::vector<std::pair<std::string, GLuint>> blockBindings;
+	ShaderCompiler::Build pending;
+	bool building = false;
+	bool reloading = false;
+	bool linked = false;
+
+	std::string name() const
+	{
+		return vertexPath + " + " + fragmentPath;
+	}
+
+	// returns false and logs when a file can't be read
+	bool readSources(std::string &vertexCode, std::string &fragmentCode) const
+	{
 		std::ifstream vShaderFile;
 		std::ifstream fShaderFile;
 
@@ -36,88 +263,207 @@ public:
 			fShaderStream << fShaderFile.rdbuf();
 			vShaderFile.close();
 			fShaderFile.close();
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			vertexCode = injectDefines(vShaderStream.str(), defines);
+			fragmentCode = injectDefines(fShaderStream.str(), defines);
 		}
 		catch (std::ifstream::failure e)
 		{
 			spdlog::critical("Failet do read shader source file");
+			return false;
 		}
-		const char *vShaderCode = vertexCode.c_str();
-		const char *fShaderCode = fragmentCode.c_str();
-
-		// compile shaders
-		unsigned int vertex, fragment;
+		return true;
+	}
 
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
+	int find(uint32_t hash) const
+	{
+		auto it = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+			[](const Uniform &u, uint32_t hash) { return u.hash < hash; });
+		if (it != uniforms.end() && it->hash == hash)
+			return (int)(it - uniforms.begin());
+		return -1;
+	}
 
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
+	// switch to a freshly linked program, then restore the uniform state the old one had
+	void adopt(GLuint program)
+	{
+		GLState &state = GLState::get();
+		GLuint old = ID;
+		std::vector<Uniform> previous;
+		previous.swap(uniforms);
+		ID = program;
+		reflectUniforms();
 
-		// shader program
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
+		state.useProgram(ID);
+		for (const Uniform &p : previous)
+		{
+			int index = find(p.hash);
+			if (!p.cached || index < 0 || uniforms[index].type != p.type)
+				continue; // gone or redeclared, the next setter call uploads it
+			Uniform &u = uniforms[index];
+			std::memcpy(u.value, p.value, sizeof(u.value));
+			u.cached = true;
+			upload(u);
+		}
+		for (const auto &block : blockBindings)
+		{
+			GLuint index = glGetUniformBlockIndex(ID, block.first.c_str());
+			if (index != GL_INVALID_INDEX)
+				glUniformBlockBinding(ID, index, block.second);
+		}
 
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		state.forgetProgram(old);
+		glDeleteProgram(old);
 	}
 
-	// on/off toggle;
-	void use()
+	// send a shadow value through the setter matching its type, the program must be in use
+	static void upload(const Uniform &u)
 	{
-		glUseProgram(ID);
+		switch (u.type)
+		{
+		case GL_FLOAT:
+			glUniform1f(u.location, *(const float *)u.value);
+			break;
+		case GL_FLOAT_VEC3:
+			glUniform3fv(u.location, 1, (const float *)u.value);
+			break;
+		case GL_FLOAT_MAT4:
+			glUniformMatrix4fv(u.location, 1, GL_FALSE, (const float *)u.value);
+			break;
+		default: // int, bool and samplers all go through setInt
+			glUniform1i(u.location, *(const int *)u.value);
+			break;
+		}
 	}
 
-	// utility uniform functions
-	void setBool(const std::string &name, bool value) const
+	// enumerate active uniforms after linking, block members have no location and are skipped
+	void reflectUniforms()
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		uniforms.clear();
+
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+
+		for (GLint i = 0; i < count; i++)
+		{
+			Uniform u;
+			GLsizei length = 0;
+			glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &u.size, &u.type, nameBuffer.data());
+			u.name.assign(nameBuffer.data(), length);
+			u.location = glGetUniformLocation(ID, u.name.c_str());
+			if (u.location < 0)
+				continue;
+
+			// arrays are reported as "name[0]", register them by their base name
+			if (u.name.size() > 3 && u.name.compare(u.name.size() - 3, 3, "[0]") == 0)
+				u.name.resize(u.name.size() - 3);
+			u.hash = UniformName::hashName(u.name.c_str());
+			uniforms.push_back(u);
+		}
+
+		std::sort(uniforms.begin(), uniforms.end(), [](const Uniform &a, const Uniform &b) { return a.hash < b.hash; });
+		for (size_t i = 1; i < uniforms.size(); i++)
+		{
+			if (uniforms[i].hash == uniforms[i - 1].hash)
+				spdlog::error("Uniform name hash collision: {} and {}", uniforms[i - 1].name, uniforms[i].name);
+		}
 	}
-	void setInt(const std::string &name, int value) const
+
+	// update the shadow copy, returns false when the upload can be skipped
+	template <typename T>
+	bool changed(UniformHandle handle, const T &value)
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		static_assert(sizeof(T) <= sizeof(Uniform::value), "uniform value too large for shadow copy");
+		if (!handle.valid())
+			return false;
+
+		Uniform &u = uniforms[handle.index];
+		if (u.cached && std::memcmp(u.value, &value, sizeof(T)) == 0)
+			return false;
+
+		std::memcpy(u.value, &value, sizeof(T));
+		u.cached = true;
+		return true;
 	}
-	void setFloat(const std::string &name, float value) const
+
+	// insert "#define" lines right after #version, which has to stay the first statement
+	static std::string injectDefines(const std::string &source, const std::string &defines)
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		if (defines.empty())
+			return source;
+
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos)
+		{
+			size_t lineEnd = source.find('\n', version);
+			insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+		}
+
+		std::string result = source.substr(0, insertAt);
+		if (!result.empty() && result.back() != '\n')
+			result += '\n';
+		result += defines;
+		if (defines.back() != '\n')
+			result += '\n';
+		result += source.substr(insertAt);
+		return result;
 	}
+};
 
-	void setMat4(const std::string& name, glm::mat4 value) 
+// Builds many programs side by side. Every add() submits its compile and link right away and nothing
+// is read back until finish(), so driver side compiler threads work on all of them at once instead of
+// the first status query serializing each program. The batch owns its shaders.
+class ShaderBatch
+{
+public:
+	Shader &add(const char *vertexPath, const char *fragmentPath, const std::string &defines = "")
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+		shaders.emplace_back(vertexPath, fragmentPath, defines, Shader::Deferred());
+		return shaders.back();
 	}
 
-private:
-	void checkCompileErrors(unsigned int shader, std::string type)
+	// collect the results in completion order when the driver reports it, returns how many failed
+	int finish()
 	{
-		int success;
-		char infoLog[1024];
-		if (type != "PROGRAM")
-		{
-			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-			if (!success)
-			{
-				glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-				spdlog::error("Shader compilation error of type: {0}\n {1}\n", type, infoLog);
-			}
-		}
-		else
+		PROFILE_ZONE("ShaderBatch finish");
+		auto start = std::chrono::steady_clock::now();
+		std::vector<Shader *> waiting;
+		for (Shader &shader : shaders)
+			waiting.push_back(&shader);
+
+		int failed = 0;
+		while (!waiting.empty())
 		{
-			glGetProgramiv(shader, GL_LINK_STATUS, &success);
-			if (!success)
+			size_t before = waiting.size();
+			for (size_t i = 0; i < waiting.size();)
 			{
-				glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-				spdlog::error("Program linking error of type: {0}\n {1}\n", type, infoLog);
+				if (!waiting[i]->buildReady())
+				{
+					i++;
+					continue;
+				}
+				if (!waiting[i]->finishBuild())
+					failed++;
+				waiting[i] = waiting.back();
+				waiting.pop_back();
 			}
+			if (waiting.size() == before)
+				std::this_thread::yield();
 		}
+
+		spdlog::info("Built {} shader programs in {:.1f} ms ({} failed)", shaders.size(),
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), failed);
+		return failed;
 	}
+
+	size_t size() const { return shaders.size(); }
+	std::deque<Shader>::iterator begin() { return shaders.begin(); }
+	std::deque<Shader>::iterator end() { return shaders.end(); }
+
+private:
+	// deque, so references handed out by add() stay valid
+	std::deque<Shader> shaders;
 };
 #endif // !SHADER_H
\ No newline at end of file
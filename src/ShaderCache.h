@@ -0,0 +1,161 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+
+// On-disk cache of linked program binaries, keyed by shader source, defines and driver identity
+class ShaderCache
+{
+public:
+	bool enabled = true;
+
+	explicit ShaderCache(std::string directory = "shader_cache") : directory(std::move(directory)) {}
+
+	// process wide cache used by Shader
+	static ShaderCache &get()
+	{
+		static ShaderCache cache;
+		return cache;
+	}
+
+	// program binaries need GL 4.1 (or ARB_get_program_binary) and at least one driver format
+	bool supported()
+	{
+		if (!probed)
+		{
+			probed = true;
+			GLint formats = 0;
+			if (GLAD_GL_VERSION_4_1)
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			available = formats > 0;
+
+			// a driver update invalidates every binary, so its identity is part of the key
+			driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+		}
+		return enabled && available;
+	}
+
+	uint64_t key(const std::string &vertexCode, const std::string &fragmentCode, const std::string &defines)
+	{
+		supported();
+		uint64_t h = 14695981039346656037ull;
+		const std::string *parts[] = {&driver, &defines, &vertexCode, &fragmentCode};
+		for (const std::string *part : parts)
+		{
+			for (unsigned char c : *part)
+				h = (h ^ c) * 1099511628211ull;
+			// separator so moving text between parts changes the key
+			h = (h ^ 0xff) * 1099511628211ull;
+		}
+		return h;
+	}
+
+	// returns true when the cached binary was accepted and the program is linked
+	bool load(GLuint program, uint64_t key)
+	{
+		if (!supported())
+			return false;
+
+		std::ifstream file(path(key), std::ios::binary);
+		if (!file)
+			return false;
+
+		Header header;
+		file.read((char *)&header, sizeof(header));
+		if (!file || header.magic != MAGIC || header.length == 0)
+			return false;
+
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), header.length);
+		if (!file)
+			return false;
+
+		glProgramBinary(program, header.format, binary.data(), (GLsizei)header.length);
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// driver rejected it (format change, corrupt file), drop it and rebuild from source
+			spdlog::warn("Program binary cache entry {:016x} rejected by driver", key);
+			file.close();
+			std::error_code ec;
+			std::filesystem::remove(path(key), ec);
+			return false;
+		}
+		return true;
+	}
+
+	// program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void store(GLuint program, uint64_t key)
+	{
+		if (!supported())
+			return;
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		Header header;
+		header.length = (uint32_t)length;
+		std::vector<char> binary(length);
+		glGetProgramBinary(program, length, NULL, &header.format, binary.data());
+
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+
+		// write to a temporary file first so a crash never leaves a truncated entry behind
+		std::string target = path(key);
+		std::string temp = target + ".tmp";
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				spdlog::warn("Failed to write program binary cache entry {}", target);
+				return;
+			}
+			file.write((const char *)&header, sizeof(header));
+			file.write(binary.data(), length);
+		}
+		std::filesystem::rename(temp, target, ec);
+		if (ec)
+			spdlog::warn("Failed to write program binary cache entry {}", target);
+	}
+
+private:
+	static const uint32_t MAGIC = 0x31485350; // "PSH1"
+
+	struct Header
+	{
+		uint32_t magic = MAGIC;
+		GLenum format = 0;
+		uint32_t length = 0;
+	};
+
+	std::string directory;
+	std::string driver;
+	bool probed = false;
+	bool available = false;
+
+	std::string path(uint64_t key) const
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+
+	static std::string glString(GLenum name)
+	{
+		const GLubyte *value = glGetString(name);
+		return value ? (const char *)value : "";
+	}
+};
+#endif // !SHADER_CACHE_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "ShaderCache.h"
+
+#include <string>
+#include <cstring>
+
+// KHR_parallel_shader_compile tokens (same values as the ARB version), glad was generated without extensions
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Builds programs in two steps: start() hands the sources to the driver without reading anything back,
+// finish() collects the compile and link results. With KHR_parallel_shader_compile the driver works on
+// its own threads in between and ready() tells, without blocking, when finish() will not stall.
+class ShaderCompiler
+{
+public:
+	// a program build in flight
+	struct Build
+	{
+		GLuint program = 0;
+		GLuint vertex = 0;
+		GLuint fragment = 0;
+		uint64_t cacheKey = 0;
+		bool cached = false; // linked straight from the binary cache, no shaders involved
+	};
+
+	// process wide compiler used by Shader
+	static ShaderCompiler &get()
+	{
+		static ShaderCompiler compiler;
+		return compiler;
+	}
+
+	// probe for the extension once GL is loaded, its entry point comes from the same loader as glad's
+	void init(GLADloadproc loader)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count && !maxShaderCompilerThreads; i++)
+		{
+			const char *name = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+			if (name == NULL)
+				continue;
+			if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+				maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsKHR");
+			else if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+				maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsARB");
+		}
+
+		if (maxShaderCompilerThreads)
+		{
+			// 0xFFFFFFFF lets the driver pick the thread count
+			maxShaderCompilerThreads(0xFFFFFFFFu);
+			spdlog::info("Parallel shader compile available");
+		}
+		else
+			spdlog::info("Parallel shader compile not available, programs build synchronously");
+	}
+
+	bool parallel() const { return maxShaderCompilerThreads != NULL; }
+
+	// create a program from preprocessed sources, the binary cache is tried first
+	Build start(const std::string &vertexCode, const std::string &fragmentCode, const std::string &defines)
+	{
+		Build build;
+		ShaderCache &cache = ShaderCache::get();
+		build.cacheKey = cache.key(vertexCode, fragmentCode, defines);
+		build.program = glCreateProgram();
+		if (cache.load(build.program, build.cacheKey))
+		{
+			build.cached = true;
+			return build;
+		}
+
+		build.vertex = compileStage(GL_VERTEX_SHADER, vertexCode);
+		build.fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
+		glAttachShader(build.program, build.vertex);
+		glAttachShader(build.program, build.fragment);
+		if (cache.supported())
+			glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(build.program);
+		return build;
+	}
+
+	// never blocks, without the extension a build is always ready and finish() waits for the driver
+	bool ready(const Build &build) const
+	{
+		if (build.cached || !parallel())
+			return true;
+		GLint done = GL_FALSE;
+		glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// read back the results and release the shader objects, errors are logged under name.
+	// Returns true when the program linked, a failed program is left for the caller to discard.
+	bool finish(Build &build, const std::string &name)
+	{
+		if (build.cached)
+		{
+			spdlog::info("Loaded shader program {} from binary cache", name);
+			return true;
+		}
+
+		bool vertexOk = checkCompileErrors(build.vertex, "VERTEX", name);
+		bool fragmentOk = checkCompileErrors(build.fragment, "FRAGMENT", name);
+		bool linked = checkCompileErrors(build.program, "PROGRAM", name);
+		if (vertexOk && fragmentOk && linked)
+			ShaderCache::get().store(build.program, build.cacheKey);
+
+		releaseShaders(build);
+		return linked;
+	}
+
+	// drop a build that failed or is no longer wanted
+	void discard(Build &build)
+	{
+		releaseShaders(build);
+		if (build.program)
+			glDeleteProgram(build.program);
+		build.program = 0;
+	}
+
+private:
+	typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+	MaxShaderCompilerThreadsProc maxShaderCompilerThreads = NULL;
+
+	static GLuint compileStage(GLenum type, const std::string &code)
+	{
+		const char *source = code.c_str();
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	static void releaseShaders(Build &build)
+	{
+		for (GLuint *shader : {&build.vertex, &build.fragment})
+		{
+			if (*shader == 0)
+				continue;
+			glDetachShader(build.program, *shader);
+			glDeleteShader(*shader);
+			*shader = 0;
+		}
+	}
+
+	// logs errors, returns true on success
+	static bool checkCompileErrors(unsigned int shader, const std::string &type, const std::string &name)
+	{
+		int success;
+		char infoLog[1024];
+		if (type != "PROGRAM")
+		{
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+				spdlog::error("Shader compilation error of type: {0} in {1}\n {2}\n", type, name, infoLog);
+			}
+		}
+		else
+		{
+			glGetProgramiv(shader, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+				spdlog::error("Program linking error of type: {0} in {1}\n {2}\n", type, name, infoLog);
+			}
+		}
+		return success != 0;
+	}
+};
+#endif // !SHADER_COMPILER_H
\ No newline at end of file
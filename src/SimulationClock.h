@@ -0,0 +1,65 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include "Log.h"
+
+#include <algorithm>
+
+// Fixed timestep clock: the render loop samples time once per frame, advance() turns that into a number
+// of whole simulation steps and alpha() is how far rendering sits between the last two steps.
+// A long frame is clamped to maxSteps so a slow frame can't snowball into ever more catch-up work.
+class SimulationClock
+{
+public:
+	explicit SimulationClock(double stepSeconds = 1.0 / 60.0, int maxSteps = 5) : stepSeconds(stepSeconds), maxSteps(maxSteps) {}
+
+	// feed this frame's time sample, returns how many fixed steps to run now
+	int advance(double now)
+	{
+		if (!started)
+		{
+			started = true;
+			lastSample = now;
+		}
+		accumulator += now - lastSample;
+		lastSample = now;
+
+		double limit = maxSteps * stepSeconds;
+		if (accumulator > limit)
+		{
+			LOG_LIMITED_DEBUG("simulation", "Simulation fell behind by {:.1f} ms, dropping it", (accumulator - limit) * 1000.0);
+			accumulator = limit;
+		}
+
+		// tolerance so a clock fed exact multiples of the step never loses one to rounding
+		int steps = 0;
+		while (accumulator + 1e-9 >= stepSeconds)
+		{
+			accumulator -= stepSeconds;
+			steps++;
+		}
+		accumulator = std::max(accumulator, 0.0);
+		stepCount += steps;
+		return steps;
+	}
+
+	// 0 renders the previous state, 1 the current one
+	float alpha() const
+	{
+		return (float)std::min(1.0, accumulator / stepSeconds);
+	}
+
+	double step() const { return stepSeconds; }
+
+	// simulated time at the latest step
+	double time() const { return stepCount * stepSeconds; }
+
+private:
+	double stepSeconds;
+	int maxSteps;
+	bool started = false;
+	double lastSample = 0.0;
+	double accumulator = 0.0;
+	long long stepCount = 0;
+};
+#endif // !SIMULATION_CLOCK_H
\ No newline at end of file
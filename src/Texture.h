@@ -4,6 +4,9 @@
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
 
+#include "GLState.h"
+#include "Profiler.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h> // texture image loader
 
@@ -16,16 +19,10 @@ public:
 	// read file and set up texture object
 	Texture(const char *imagePath, GLenum format)
 	{
-		stbi_set_flip_vertically_on_load(true); // flip images on load
+		PROFILE_ZONE("Texture load");
+		stbi_set_flip_vertically_on_load_thread(true); // flip images on load
 
-		glGenTextures(1, &ID);
-		glBindTexture(GL_TEXTURE_2D, ID);
-		// wrapping options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// filtering options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		create();
 
 		int img_w, img_h, nrChannels;
 		unsigned char *tex_data = stbi_load(imagePath, &img_w, &img_h, &nrChannels, 0);
@@ -40,5 +37,49 @@ public:
 		}
 		stbi_image_free(tex_data);
 	}
+
+	// texture object holding a 1x1 placeholder until real pixels are uploaded
+	Texture()
+	{
+		create();
+		const unsigned char placeholder[4] = {128, 128, 128, 255};
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	}
+
+	// wrap an existing texture object
+	explicit Texture(unsigned int id) : ID(id) {}
+
+	// replace the contents with decoded 8 bit pixels, channel count picks the format
+	void upload(const unsigned char *pixels, int width, int height, int channels)
+	{
+		PROFILE_ZONE("Texture upload");
+		static const GLenum formats[5] = {0, GL_RED, GL_RG, GL_RGB, GL_RGBA};
+		static const GLenum internalFormats[5] = {0, GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+		if (channels < 1 || channels > 4)
+		{
+			spdlog::error("Unsupported texture channel count {}", channels);
+			return;
+		}
+
+		GLState::get().bindTexture(GL_TEXTURE_2D, ID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[channels], width, height, 0, formats[channels], GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+private:
+	// generate and bind the texture object with default sampling state
+	void create()
+	{
+		glGenTextures(1, &ID);
+		GLState::get().bindTexture(GL_TEXTURE_2D, ID);
+		// wrapping options
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// filtering options
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
 };
 #endif // !TEXTURE_H
\ No newline at end of file
@@ -0,0 +1,298 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "Profiler.h"
+
+#include <vector>
+#include <algorithm>
+
+// where a texture landed: sample page layer at uv * scale + offset
+struct AtlasRegion
+{
+	glm::vec2 scale;
+	glm::vec2 offset;
+	float layer;
+};
+
+// RGBA8 texture array whose layers are atlas pages, textures of any size are shelf packed into them so
+// everything that samples the atlas draws with a single binding. Regions start 16 texel aligned with a
+// clamped 8 texel border, so mip levels 0-4 never filter one texture into its neighbour. The mip chain is
+// uploaded per region: prepare() builds every level off the render thread, from a baked chain when there
+// is one, and place() only copies them in.
+class TextureAtlas
+{
+public:
+	static const int ALIGN = 16;
+	static const int PADDING = 8;
+	static const int LEVELS = 5; // 16 texel alignment covers 2^4
+
+	// texture array id
+	unsigned int ID;
+
+	// one mip level of a source image, 8 bit with rows tightly packed
+	struct SourceLevel
+	{
+		const unsigned char *pixels;
+		int width, height;
+	};
+
+	// an image ready to be placed: the bordered RGBA rectangle of every atlas level, level l is
+	// rectWidth >> l by rectHeight >> l
+	struct Image
+	{
+		int width = 0, height = 0; // level 0 without the border, after shrinking to fit a page
+		int rectWidth = 0, rectHeight = 0;
+		std::vector<unsigned char> levels[LEVELS];
+	};
+
+	TextureAtlas(int pageSize = 2048, int pages = 2) : pages(pages)
+	{
+		GLint maxSize = 0, maxLayers = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		this->pageSize = std::min(pageSize, (int)maxSize);
+		this->pages = std::min(pages, (int)maxLayers);
+		pageTop.assign(this->pages, 0);
+
+		glGenTextures(1, &ID);
+		GLState::get().bindTexture(GL_TEXTURE_2D_ARRAY, ID);
+		for (int level = 0; level < LEVELS; level++)
+		{
+			int size = std::max(1, this->pageSize >> level);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, this->pages, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, LEVELS - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// regions show a gray tile until their pixels are placed, same as the Texture placeholder
+		const unsigned char gray[4] = {128, 128, 128, 255};
+		Image image;
+		if (prepare({{gray, 1, 1}}, 4, image))
+			place(placeholder, image);
+	}
+
+	~TextureAtlas()
+	{
+		GLState::get().forgetTexture(ID);
+		glDeleteTextures(1, &ID);
+	}
+
+	TextureAtlas(const TextureAtlas &) = delete;
+	TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+	// new region showing the placeholder, returns its index for region() and place()
+	int reserve()
+	{
+		regions.push_back(placeholder);
+		return (int)regions.size() - 1;
+	}
+
+	// Build the atlas levels of an image with 1-4 channels from its mip chain, levels[0] is the full size
+	// image and any further levels must halve it like bakeTexture does. Levels that are missing are box
+	// filtered from the last one, images larger than a page start further down the chain. Only reads the
+	// page size, so decode threads call it while the render thread places other images.
+	bool prepare(const std::vector<SourceLevel> &levels, int channels, Image &image) const
+	{
+		PROFILE_ZONE("TextureAtlas prepare");
+		if (levels.empty() || channels < 1 || channels > 4 || levels[0].width <= 0 || levels[0].height <= 0)
+		{
+			spdlog::error("Unsupported atlas image with {} channels", channels);
+			return false;
+		}
+
+		size_t source = 0;
+		int width = levels[0].width, height = levels[0].height;
+		std::vector<unsigned char> rgba = expand(levels[0], channels);
+		while (alignUp(width + 2 * PADDING) > pageSize || alignUp(height + 2 * PADDING) > pageSize)
+			next(levels, channels, source, rgba, width, height);
+
+		image.width = width;
+		image.height = height;
+		image.rectWidth = alignUp(width + 2 * PADDING);
+		image.rectHeight = alignUp(height + 2 * PADDING);
+		for (int level = 0; level < LEVELS; level++)
+		{
+			if (level > 0)
+				next(levels, channels, source, rgba, width, height);
+			border(rgba, width, height, image, level);
+		}
+		return true;
+	}
+
+	// copy a prepared image into a reserved region, render thread only
+	bool place(int index, const Image &image)
+	{
+		if (index < 0 || index >= (int)regions.size())
+			return false;
+		return place(regions[index], image);
+	}
+
+	const AtlasRegion &region(int index) const { return regions[index]; }
+	size_t regionCount() const { return regions.size(); }
+
+private:
+	struct Shelf
+	{
+		int page;
+		int y;
+		int height;
+		int x; // next free column
+	};
+
+	int pageSize;
+	int pages;
+	std::vector<int> pageTop; // first row above the last shelf of each page
+	std::vector<Shelf> shelves;
+	std::vector<AtlasRegion> regions;
+	AtlasRegion placeholder = {glm::vec2(0.0f), glm::vec2(0.0f), 0.0f};
+
+	static int alignUp(int value)
+	{
+		return (value + ALIGN - 1) / ALIGN * ALIGN;
+	}
+
+	bool place(AtlasRegion &region, const Image &image)
+	{
+		PROFILE_ZONE("TextureAtlas place");
+		int page, x, y;
+		if (!allocate(image.rectWidth, image.rectHeight, page, x, y))
+		{
+			spdlog::error("Texture atlas full ({} pages of {}), {}x{} image not placed", pages, pageSize, image.width, image.height);
+			return false;
+		}
+
+		// 16 texel alignment keeps every level's rectangle on whole texels
+		GLState::get().bindTexture(GL_TEXTURE_2D_ARRAY, ID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = 0; level < LEVELS; level++)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x >> level, y >> level, page, image.rectWidth >> level, image.rectHeight >> level, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.levels[level].data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		region.scale = glm::vec2((float)image.width / pageSize, (float)image.height / pageSize);
+		region.offset = glm::vec2((float)(x + PADDING) / pageSize, (float)(y + PADDING) / pageSize);
+		region.layer = (float)page;
+		return true;
+	}
+
+	// missing channels read as in a GL_RED/GL_RG/GL_RGB texture
+	static std::vector<unsigned char> expand(const SourceLevel &level, int channels)
+	{
+		std::vector<unsigned char> rgba((size_t)level.width * level.height * 4);
+		for (size_t i = 0; i < (size_t)level.width * level.height; i++)
+		{
+			const unsigned char *src = level.pixels + i * channels;
+			unsigned char *dst = &rgba[i * 4];
+			dst[0] = src[0];
+			dst[1] = channels > 1 ? src[1] : 0;
+			dst[2] = channels > 2 ? src[2] : 0;
+			dst[3] = channels > 3 ? src[3] : 255;
+		}
+		return rgba;
+	}
+
+	// step one level down the chain, from the source levels while they last
+	static void next(const std::vector<SourceLevel> &levels, int channels, size_t &source, std::vector<unsigned char> &rgba, int &width, int &height)
+	{
+		if (++source < levels.size())
+		{
+			rgba = expand(levels[source], channels);
+			width = levels[source].width;
+			height = levels[source].height;
+		}
+		else
+		{
+			halve(rgba, width, height);
+		}
+	}
+
+	// every texel of the level's rectangle takes the image texel under its centre, clamped to the edge, so
+	// the border repeats the nearest edge and the image lines up with level 0
+	static void border(const std::vector<unsigned char> &rgba, int width, int height, Image &image, int level)
+	{
+		int rectWidth = image.rectWidth >> level, rectHeight = image.rectHeight >> level;
+		std::vector<unsigned char> &rect = image.levels[level];
+		rect.resize((size_t)rectWidth * rectHeight * 4);
+		for (int ry = 0; ry < rectHeight; ry++)
+		{
+			int sy = sourceTexel(ry, level, height);
+			for (int rx = 0; rx < rectWidth; rx++)
+			{
+				int sx = sourceTexel(rx, level, width);
+				std::copy_n(&rgba[((size_t)sy * width + sx) * 4], 4, &rect[((size_t)ry * rectWidth + rx) * 4]);
+			}
+		}
+	}
+
+	// image texel under the centre of rectangle texel r. A level l texel covers 2^l level 0 texels, odd
+	// sizes drop the remainder, the same as halve() and bakeTexture.
+	static int sourceTexel(int r, int level, int size)
+	{
+		int centre = ((2 * r + 1) << level) - 2 * PADDING; // twice the level 0 coordinate
+		if (centre < 0)
+			return 0;
+		return std::min(centre >> (level + 1), size - 1);
+	}
+
+	// first shelf with room and enough height, otherwise open a new shelf on the first page that has space
+	bool allocate(int width, int height, int &page, int &x, int &y)
+	{
+		for (Shelf &shelf : shelves)
+		{
+			if (height <= shelf.height && shelf.x + width <= pageSize)
+			{
+				page = shelf.page;
+				x = shelf.x;
+				y = shelf.y;
+				shelf.x += width;
+				return true;
+			}
+		}
+		for (int p = 0; p < pages; p++)
+		{
+			if (pageTop[p] + height <= pageSize)
+			{
+				shelves.push_back({p, pageTop[p], height, width});
+				pageTop[p] += height;
+				page = p;
+				x = 0;
+				y = shelves.back().y;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 2x2 box filter, odd sizes clamp the second sample to the edge like bakeTexture
+	static void halve(std::vector<unsigned char> &rgba, int &width, int &height)
+	{
+		int dstWidth = std::max(1, width / 2), dstHeight = std::max(1, height / 2);
+		std::vector<unsigned char> dst((size_t)dstWidth * dstHeight * 4);
+		for (int y = 0; y < dstHeight; y++)
+		{
+			int y0 = std::min(height - 1, y * 2), y1 = std::min(height - 1, y * 2 + 1);
+			for (int x = 0; x < dstWidth; x++)
+			{
+				int x0 = std::min(width - 1, x * 2), x1 = std::min(width - 1, x * 2 + 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c] +
+							  rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+					dst[((size_t)y * dstWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		rgba.swap(dst);
+		width = dstWidth;
+		height = dstHeight;
+	}
+};
+#endif // !TEXTURE_ATLAS_H
\ No newline at end of file
@@ -0,0 +1,246 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Texture.h"
+#include "BakedTexture.h"
+#include "TextureAtlas.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <cstdint>
+
+// Decodes image files as background jobs on the job system. load() returns a texture bound to a 1x1 placeholder
+// right away; the render thread swaps in the real pixels from pumpUploads() once decoding is done.
+// Images can also be loaded into a TextureAtlas region, the decode job also builds the region's mip levels.
+// When a baked .btex sits next to the image it is memory mapped instead and no decoder runs at all.
+class TextureLoader
+{
+public:
+	explicit TextureLoader(JobSystem &jobs) : jobs(jobs) {}
+
+	// decodes that have not started are skipped, running ones are waited for
+	~TextureLoader()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+			decodeDone.wait(lock, [this] { return decoding == 0; });
+		}
+		for (Decoded &decoded : completed)
+			stbi_image_free(decoded.pixels);
+	}
+
+	TextureLoader(const TextureLoader &) = delete;
+	TextureLoader &operator=(const TextureLoader &) = delete;
+
+	// render thread only, creates the placeholder texture and queues the decode
+	Texture load(const std::string &imagePath)
+	{
+		Texture texture;
+		submit({imagePath, texture.ID});
+		return texture;
+	}
+
+	// render thread only, reserves an atlas region showing the placeholder and queues the decode.
+	// Loading the same path into the same atlas again returns the existing region unless share is false.
+	int load(const std::string &imagePath, TextureAtlas &atlas, bool share = true)
+	{
+		if (share)
+		{
+			auto known = atlasRegions.find({&atlas, imagePath});
+			if (known != atlasRegions.end())
+				return known->second;
+		}
+
+		int region = atlas.reserve();
+		if (share)
+			atlasRegions[{&atlas, imagePath}] = region;
+		submit({imagePath, 0, &atlas, region});
+		return region;
+	}
+
+	// render thread only, uploads at most maxUploads finished images, returns how many were uploaded
+	size_t pumpUploads(size_t maxUploads = 4)
+	{
+		PROFILE_ZONE("TextureLoader pumpUploads");
+		std::vector<Decoded> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t take = std::min(maxUploads, completed.size());
+			ready.assign(std::make_move_iterator(completed.begin()), std::make_move_iterator(completed.begin() + take));
+			completed.erase(completed.begin(), completed.begin() + take);
+		}
+
+		for (Decoded &decoded : ready)
+		{
+			if (decoded.atlas)
+			{
+				if (decoded.atlasImage.rectWidth > 0)
+					decoded.atlas->place(decoded.region, decoded.atlasImage);
+				else
+					spdlog::error("Failed to load texture file {}", decoded.path);
+			}
+			else if (decoded.baked)
+			{
+				decoded.baked->upload(decoded.textureID);
+			}
+			else if (decoded.pixels)
+			{
+				Texture(decoded.textureID).upload(decoded.pixels, decoded.width, decoded.height, decoded.channels);
+				stbi_image_free(decoded.pixels);
+			}
+			else
+			{
+				spdlog::error("Failed to load texture file {}", decoded.path);
+			}
+		}
+		if (!ready.empty())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			inFlight -= ready.size();
+		}
+		return ready.size();
+	}
+
+	// render thread only, blocks until every queued texture is uploaded
+	void finishAll()
+	{
+		while (pending() > 0)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				decodeDone.wait(lock, [this] { return !completed.empty(); });
+			}
+			pumpUploads(SIZE_MAX);
+		}
+	}
+
+	// textures queued or decoded but not uploaded yet
+	size_t pending()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return inFlight;
+	}
+
+private:
+	struct Request
+	{
+		std::string path;
+		unsigned int textureID;
+		TextureAtlas *atlas = NULL; // set for atlas loads instead of textureID
+		int region = -1;
+	};
+
+	struct Decoded
+	{
+		std::string path;
+		unsigned int textureID;
+		TextureAtlas *atlas = NULL;
+		int region = -1;
+		unsigned char *pixels = NULL;
+		int width = 0, height = 0, channels = 0;
+		std::unique_ptr<BakedTexture> baked;
+		TextureAtlas::Image atlasImage; // atlas loads carry this instead of pixels or baked
+	};
+
+	JobSystem &jobs;
+	std::mutex mutex;
+	std::condition_variable decodeDone;
+	std::vector<Decoded> completed;
+	size_t inFlight = 0;
+	size_t decoding = 0; // jobs queued or running
+	bool stopping = false;
+	std::map<std::pair<TextureAtlas *, std::string>, int> atlasRegions; // render thread only
+
+	// atlas pages are RGBA8, only 8 bit baked files can be placed. Their mip levels are used as they are,
+	// a decoded image gets its levels filtered here, either way the render thread only copies them in.
+	static void prepareForAtlas(Decoded &decoded)
+	{
+		const TextureAtlas &atlas = *decoded.atlas;
+		if (decoded.baked)
+		{
+			std::vector<TextureAtlas::SourceLevel> levels;
+			for (uint32_t i = 0; i < decoded.baked->info().levels; i++)
+				levels.push_back({decoded.baked->levelData(i), (int)decoded.baked->level(i).width, (int)decoded.baked->level(i).height});
+			atlas.prepare(levels, decoded.baked->channels(), decoded.atlasImage);
+			decoded.baked.reset();
+		}
+		else if (decoded.pixels)
+		{
+			atlas.prepare({{decoded.pixels, decoded.width, decoded.height}}, decoded.channels, decoded.atlasImage);
+			stbi_image_free(decoded.pixels);
+			decoded.pixels = NULL;
+		}
+	}
+
+	// file reads and decoding block, so they go out as background jobs the render thread never runs
+	void submit(Request request)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			inFlight++;
+			decoding++;
+		}
+		jobs.runBackground(jobs.create([this, request]() { decode(request); }));
+	}
+
+	void decode(const Request &request)
+	{
+		bool skip;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			skip = stopping;
+		}
+
+		Decoded decoded;
+		if (!skip)
+		{
+			PROFILE_ZONE("Texture decode");
+			// stb keeps the flip flag per thread with this call, the global setter would race other decoders
+			stbi_set_flip_vertically_on_load_thread(true);
+			decoded.path = request.path;
+			decoded.textureID = request.textureID;
+			decoded.atlas = request.atlas;
+			decoded.region = request.region;
+
+			std::string bakedPath = bakedTexturePath(request.path);
+			std::error_code ec;
+			if (std::filesystem::exists(bakedPath, ec))
+			{
+				decoded.baked = std::make_unique<BakedTexture>();
+				if (decoded.baked->open(bakedPath) && (!decoded.atlas || decoded.baked->channels() > 0))
+					decoded.baked->prefetch();
+				else
+					decoded.baked.reset();
+			}
+			if (!decoded.baked)
+			{
+				SPDLOG_DEBUG("No baked texture for {}, decoding", request.path);
+				decoded.pixels = stbi_load(request.path.c_str(), &decoded.width, &decoded.height, &decoded.channels, 0);
+			}
+			if (decoded.atlas)
+				prepareForAtlas(decoded);
+		}
+
+		// notify under the lock, once decoding reads 0 the destructor may return and take decodeDone with it
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!skip)
+			completed.push_back(std::move(decoded));
+		decoding--;
+		decodeDone.notify_all();
+	}
+};
+#endif // !TEXTURE_LOADER_H
\ No newline at end of file
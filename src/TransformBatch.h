@@ -0,0 +1,172 @@
+#ifndef TRANSFORM_BATCH_H
+#define TRANSFORM_BATCH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SSE 1
+#include <immintrin.h>
+#endif
+#if defined(__AVX__)
+#define TRANSFORM_AVX 1
+#endif
+
+// Translation, unit quaternion rotation and scale in structure-of-arrays form, one SIMD lane per object
+struct TransformArrays
+{
+	std::vector<float> px, py, pz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+
+	size_t size() const { return px.size(); }
+
+	// new entries are identity transforms
+	void resize(size_t count)
+	{
+		for (std::vector<float> *v : {&px, &py, &pz, &qx, &qy, &qz})
+			v->resize(count, 0.0f);
+		for (std::vector<float> *v : {&qw, &sx, &sy, &sz})
+			v->resize(count, 1.0f);
+	}
+
+	void set(size_t i, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale = glm::vec3(1.0f))
+	{
+		px[i] = position.x;
+		py[i] = position.y;
+		pz[i] = position.z;
+		setRotation(i, rotation);
+		sx[i] = scale.x;
+		sy[i] = scale.y;
+		sz[i] = scale.z;
+	}
+
+	void setRotation(size_t i, const glm::quat &rotation)
+	{
+		qx[i] = rotation.x;
+		qy[i] = rotation.y;
+		qz[i] = rotation.z;
+		qw[i] = rotation.w;
+	}
+};
+
+namespace transforms
+{
+	// translate * rotate * scale of one object, written as a column-major 4x4 like glm::mat4
+	inline void composeOne(const TransformArrays &t, size_t i, float *out)
+	{
+		float x = t.qx[i], y = t.qy[i], z = t.qz[i], w = t.qw[i];
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		out[0] = (1.0f - 2.0f * (yy + zz)) * t.sx[i];
+		out[1] = 2.0f * (xy + wz) * t.sx[i];
+		out[2] = 2.0f * (xz - wy) * t.sx[i];
+		out[3] = 0.0f;
+		out[4] = 2.0f * (xy - wz) * t.sy[i];
+		out[5] = (1.0f - 2.0f * (xx + zz)) * t.sy[i];
+		out[6] = 2.0f * (yz + wx) * t.sy[i];
+		out[7] = 0.0f;
+		out[8] = 2.0f * (xz + wy) * t.sz[i];
+		out[9] = 2.0f * (yz - wx) * t.sz[i];
+		out[10] = (1.0f - 2.0f * (xx + yy)) * t.sz[i];
+		out[11] = 0.0f;
+		out[12] = t.px[i];
+		out[13] = t.py[i];
+		out[14] = t.pz[i];
+		out[15] = 1.0f;
+	}
+}
+
+// Build the matrices of transforms [first, last) into matrices[first, last). The vector paths compute
+// each matrix element for 8 (AVX) or 4 (SSE) objects at once and transpose the lanes back into
+// per-object columns; the scalar loop covers the tail. No trig: rotations arrive as quaternions.
+inline void composeTransforms(const TransformArrays &t, size_t first, size_t last, glm::mat4 *matrices)
+{
+	const size_t count = std::min(last, t.size());
+	float *out = &matrices[0][0][0];
+	size_t i = first;
+
+#if TRANSFORM_AVX
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&t.qx[i]), y = _mm256_loadu_ps(&t.qy[i]), z = _mm256_loadu_ps(&t.qz[i]), w = _mm256_loadu_ps(&t.qw[i]);
+		__m256 sx = _mm256_loadu_ps(&t.sx[i]), sy = _mm256_loadu_ps(&t.sy[i]), sz = _mm256_loadu_ps(&t.sz[i]);
+		__m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+		__m256 x2 = _mm256_mul_ps(x, two), y2 = _mm256_mul_ps(y, two), z2 = _mm256_mul_ps(z, two);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+		// element [column][row] for all eight objects
+		__m256 m[4][4] = {
+			{_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx), _mm256_mul_ps(_mm256_add_ps(xy, wz), sx), _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), _mm256_setzero_ps()},
+			{_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy), _mm256_mul_ps(_mm256_add_ps(yz, wx), sy), _mm256_setzero_ps()},
+			{_mm256_mul_ps(_mm256_add_ps(xz, wy), sz), _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), _mm256_setzero_ps()},
+			{_mm256_loadu_ps(&t.px[i]), _mm256_loadu_ps(&t.py[i]), _mm256_loadu_ps(&t.pz[i]), one}};
+
+		// 4x8 transpose per column: low halves hold objects 0-3, high halves objects 4-7
+		for (int c = 0; c < 4; c++)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(m[c][0], m[c][1]), t1 = _mm256_unpackhi_ps(m[c][0], m[c][1]);
+			__m256 t2 = _mm256_unpacklo_ps(m[c][2], m[c][3]), t3 = _mm256_unpackhi_ps(m[c][2], m[c][3]);
+			__m256 o0 = _mm256_shuffle_ps(t0, t2, 0x44), o1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+			__m256 o2 = _mm256_shuffle_ps(t1, t3, 0x44), o3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+			float *base = out + i * 16 + c * 4;
+			_mm_storeu_ps(base, _mm256_castps256_ps128(o0));
+			_mm_storeu_ps(base + 16, _mm256_castps256_ps128(o1));
+			_mm_storeu_ps(base + 32, _mm256_castps256_ps128(o2));
+			_mm_storeu_ps(base + 48, _mm256_castps256_ps128(o3));
+			_mm_storeu_ps(base + 64, _mm256_extractf128_ps(o0, 1));
+			_mm_storeu_ps(base + 80, _mm256_extractf128_ps(o1, 1));
+			_mm_storeu_ps(base + 96, _mm256_extractf128_ps(o2, 1));
+			_mm_storeu_ps(base + 112, _mm256_extractf128_ps(o3, 1));
+		}
+	}
+#endif
+#if TRANSFORM_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&t.qx[i]), y = _mm_loadu_ps(&t.qy[i]), z = _mm_loadu_ps(&t.qz[i]), w = _mm_loadu_ps(&t.qw[i]);
+		__m128 sx = _mm_loadu_ps(&t.sx[i]), sy = _mm_loadu_ps(&t.sy[i]), sz = _mm_loadu_ps(&t.sz[i]);
+		__m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+		__m128 m[4][4] = {
+			{_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(xz, wy), sx), _mm_setzero_ps()},
+			{_mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy), _mm_mul_ps(_mm_add_ps(yz, wx), sy), _mm_setzero_ps()},
+			{_mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), _mm_setzero_ps()},
+			{_mm_loadu_ps(&t.px[i]), _mm_loadu_ps(&t.py[i]), _mm_loadu_ps(&t.pz[i]), one}};
+
+		for (int c = 0; c < 4; c++)
+		{
+			_MM_TRANSPOSE4_PS(m[c][0], m[c][1], m[c][2], m[c][3]);
+			float *base = out + i * 16 + c * 4;
+			_mm_storeu_ps(base, m[c][0]);
+			_mm_storeu_ps(base + 16, m[c][1]);
+			_mm_storeu_ps(base + 32, m[c][2]);
+			_mm_storeu_ps(base + 48, m[c][3]);
+		}
+	}
+#endif
+	// scalar tail, or the whole array without SSE
+	for (; i < count; i++)
+		transforms::composeOne(t, i, out + i * 16);
+}
+
+// every transform, matrices is resized to match
+inline void composeTransforms(const TransformArrays &t, std::vector<glm::mat4> &matrices)
+{
+	matrices.resize(t.size());
+	if (!matrices.empty())
+		composeTransforms(t, 0, t.size(), matrices.data());
+}
+#endif // !TRANSFORM_BATCH_H
\ No newline at end of file
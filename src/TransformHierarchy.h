@@ -0,0 +1,110 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include "Profiler.h"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Parent/child transforms in flat arrays indexed by node. A parent has to exist before its children are
+// added, so every node is stored after its parent and a single forward pass computes world matrices top
+// down. setLocal() only flags the node; update() recomputes flagged nodes and everything below them and
+// reports which world matrices changed, a scene that does not move costs nothing. Nodes whose world
+// matrix is cheaper to build in a batch (composeTransforms) take it through setWorld() instead.
+class TransformHierarchy
+{
+public:
+	static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+	void reserve(size_t nodes)
+	{
+		parents.reserve(nodes);
+		locals.reserve(nodes);
+		worlds.reserve(nodes);
+		dirty.reserve(nodes);
+		stamps.reserve(nodes);
+	}
+
+	// returns the new node, its world matrix is valid after the next update()
+	uint32_t add(const glm::mat4 &local, uint32_t parent = NO_PARENT)
+	{
+		uint32_t node = (uint32_t)locals.size();
+		parents.push_back(parent < node ? parent : NO_PARENT);
+		locals.push_back(local);
+		worlds.push_back(local);
+		dirty.push_back(LOCAL_CHANGED);
+		stamps.push_back(0);
+		firstDirty = std::min(firstDirty, node);
+		return node;
+	}
+
+	void setLocal(uint32_t node, const glm::mat4 &local)
+	{
+		locals[node] = local;
+		dirty[node] = LOCAL_CHANGED;
+		firstDirty = std::min(firstDirty, node);
+	}
+
+	// world matrix the caller already composed with the parent's, update() keeps it as is and only
+	// recomputes the children. local(node) is not kept in sync.
+	void setWorld(uint32_t node, const glm::mat4 &world)
+	{
+		worlds[node] = world;
+		dirty[node] = WORLD_CHANGED;
+		firstDirty = std::min(firstDirty, node);
+	}
+
+	// recompute what changed since the last update, returns the nodes whose world matrix was rewritten in
+	// ascending order. Only flags are visited before the first dirty node, only matrices that changed are touched.
+	const std::vector<uint32_t> &update()
+	{
+		PROFILE_ZONE("TransformHierarchy update");
+		changed.clear();
+		uint32_t count = (uint32_t)locals.size();
+		if (firstDirty >= count)
+			return changed;
+
+		// a node stamped with this pass was rewritten, its children follow it
+		pass++;
+		for (uint32_t node = firstDirty; node < count; node++)
+		{
+			uint32_t parent = parents[node];
+			bool parentChanged = parent != NO_PARENT && stamps[parent] == pass;
+			if (!dirty[node] && !parentChanged)
+				continue;
+			if (dirty[node] != WORLD_CHANGED)
+				worlds[node] = parent == NO_PARENT ? locals[node] : worlds[parent] * locals[node];
+			dirty[node] = CLEAN;
+			stamps[node] = pass;
+			changed.push_back(node);
+		}
+		firstDirty = UINT32_MAX;
+		return changed;
+	}
+
+	const glm::mat4 &world(uint32_t node) const { return worlds[node]; }
+	const glm::mat4 &local(uint32_t node) const { return locals[node]; }
+	uint32_t parent(uint32_t node) const { return parents[node]; }
+	size_t size() const { return locals.size(); }
+
+private:
+	enum : uint8_t
+	{
+		CLEAN,
+		LOCAL_CHANGED,
+		WORLD_CHANGED
+	};
+
+	std::vector<uint32_t> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	std::vector<uint32_t> stamps;
+	std::vector<uint32_t> changed;
+	uint32_t firstDirty = UINT32_MAX;
+	uint32_t pass = 0;
+};
+#endif // !TRANSFORM_HIERARCHY_H
\ No newline at end of file
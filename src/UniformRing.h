@@ -0,0 +1,186 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "GLState.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Per-frame uniform buffer split into FRAMES regions used round robin. With GL 4.4 buffer storage the
+// whole buffer is persistently mapped and written in place, a fence per region keeps the CPU from
+// overwriting data the GPU has not consumed yet. Without it writes go to a CPU copy that flush()
+// uploads with glBufferSubData after orphaning the store.
+class UniformRing
+{
+public:
+	static const int FRAMES = 3;
+
+	// a suballocation, ptr stays valid until the next beginFrame()
+	struct Allocation
+	{
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		void *ptr = NULL;
+
+		bool valid() const { return ptr != NULL; }
+	};
+
+	// uniform buffer id
+	unsigned int ID;
+
+	explicit UniformRing(size_t bytesPerFrame = 64 * 1024)
+	{
+		GLint offsetAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+		alignment = offsetAlignment > 0 ? (size_t)offsetAlignment : 256;
+		frameSize = alignUp(bytesPerFrame);
+
+		glGenBuffers(1, &ID);
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, ID);
+		persistent = GLAD_GL_VERSION_4_4 != 0;
+		if (persistent)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_UNIFORM_BUFFER, frameSize * FRAMES, NULL, flags);
+			mapped = (unsigned char *)glMapBufferRange(GL_UNIFORM_BUFFER, 0, frameSize * FRAMES, flags);
+			if (!mapped)
+			{
+				// immutable storage cannot be respecified, start over with a fresh buffer
+				spdlog::warn("Persistent uniform buffer mapping failed, falling back to glBufferSubData");
+				GLState::get().forgetBuffer(ID);
+				glDeleteBuffers(1, &ID);
+				glGenBuffers(1, &ID);
+				GLState::get().bindBuffer(GL_UNIFORM_BUFFER, ID);
+				persistent = false;
+			}
+		}
+		if (!persistent)
+		{
+			glBufferData(GL_UNIFORM_BUFFER, frameSize * FRAMES, NULL, GL_STREAM_DRAW);
+			staging.resize(frameSize);
+		}
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	~UniformRing()
+	{
+		for (GLsync &fence : fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+		if (persistent)
+		{
+			GLState::get().bindBuffer(GL_UNIFORM_BUFFER, ID);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			GLState::get().bindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		GLState::get().forgetBuffer(ID);
+		glDeleteBuffers(1, &ID);
+	}
+
+	UniformRing(const UniformRing &) = delete;
+	UniformRing &operator=(const UniformRing &) = delete;
+
+	bool isPersistent() const { return persistent; }
+
+	// render thread, move to the next region and wait until the GPU is done reading it
+	void beginFrame()
+	{
+		frame = (frame + 1) % FRAMES;
+		GLsync &fence = fences[frame];
+		if (fence)
+		{
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+			glDeleteSync(fence);
+			fence = 0;
+		}
+		head.store(0, std::memory_order_relaxed);
+	}
+
+	// thread safe between beginFrame() and flush(), returns an invalid allocation when the region is full
+	Allocation allocate(size_t size)
+	{
+		Allocation allocation;
+		size_t aligned = alignUp(size);
+		size_t offset = head.fetch_add(aligned, std::memory_order_relaxed);
+		if (offset + aligned > frameSize)
+		{
+			spdlog::error("Uniform ring region full ({} bytes), increase bytesPerFrame", frameSize);
+			return allocation;
+		}
+
+		allocation.offset = (GLintptr)(frame * frameSize + offset);
+		allocation.size = (GLsizeiptr)size;
+		allocation.ptr = persistent ? mapped + allocation.offset : staging.data() + offset;
+		return allocation;
+	}
+
+	// allocate and copy in one step
+	template <typename T>
+	Allocation push(const T &data)
+	{
+		Allocation allocation = allocate(sizeof(T));
+		if (allocation.valid())
+			std::memcpy(allocation.ptr, &data, sizeof(T));
+		return allocation;
+	}
+
+	// render thread, makes this frame's writes visible to the GPU, call before drawing with them
+	void flush()
+	{
+		if (persistent)
+			return; // coherent mapping, nothing to do
+
+		size_t used = std::min(head.load(std::memory_order_relaxed), frameSize);
+		if (used == 0)
+			return;
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, ID);
+		if (frame == 0)
+		{
+			// orphan once per cycle so the driver hands out fresh storage instead of syncing
+			glBufferData(GL_UNIFORM_BUFFER, frameSize * FRAMES, NULL, GL_STREAM_DRAW);
+		}
+		glBufferSubData(GL_UNIFORM_BUFFER, frame * frameSize, used, staging.data());
+		GLState::get().bindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// attach an allocation to a uniform block binding point
+	void bind(GLuint binding, const Allocation &allocation)
+	{
+		if (allocation.valid())
+			GLState::get().bindBufferRange(GL_UNIFORM_BUFFER, binding, ID, allocation.offset, allocation.size);
+	}
+
+	// render thread, after the last draw reading this frame's region
+	void endFrame()
+	{
+		// orphaned uploads are versioned by the driver, only the mapped path needs fencing
+		if (persistent)
+			fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+private:
+	size_t alignment;
+	size_t frameSize;
+	bool persistent = false;
+	unsigned char *mapped = NULL;
+	std::vector<unsigned char> staging;
+	GLsync fences[FRAMES] = {};
+	int frame = FRAMES - 1;
+	std::atomic<size_t> head{0};
+
+	size_t alignUp(size_t size) const
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+};
+#endif // !UNIFORM_RING_H
\ No newline at end of file
@@ -0,0 +1,347 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// storage format of one vertex attribute, everything but FLOAT is expanded by the vertex fetch hardware
+enum class VertexFormat
+{
+	FLOAT2,
+	FLOAT3,
+	HALF2,					// uv
+	SNORM16x4,				// position or normal xyz, w is padding
+	SNORM_10_10_10_2,		// position or normal xyz in one 32 bit word
+	OCTAHEDRAL_SNORM16x2	// unit normal folded onto an octahedron, decoded in shader.vert
+};
+
+enum class VertexSemantic
+{
+	POSITION,
+	TEXCOORD,
+	NORMAL
+};
+
+struct VertexAttribute
+{
+	VertexSemantic semantic;
+	VertexFormat format;
+	GLuint location;
+	GLuint offset;
+};
+
+// Interleaved vertex description: attribute formats, offsets and stride. apply() replaces hand written
+// glVertexAttribPointer calls, shaderDefines() tells shader.vert how to decode what it is fed.
+class VertexLayout
+{
+public:
+	VertexLayout &add(VertexSemantic semantic, VertexFormat format, GLuint location)
+	{
+		attributeList.push_back({semantic, format, location, (GLuint)vertexStride});
+		vertexStride += formatSize(format);
+		return *this;
+	}
+
+	// plain floats, 20 bytes per vertex without normals
+	static VertexLayout uncompressed(bool normals = false)
+	{
+		VertexLayout layout;
+		layout.add(VertexSemantic::POSITION, VertexFormat::FLOAT3, 0);
+		layout.add(VertexSemantic::TEXCOORD, VertexFormat::FLOAT2, 1);
+		if (normals)
+			layout.add(VertexSemantic::NORMAL, VertexFormat::FLOAT3, NORMAL_LOCATION);
+		return layout;
+	}
+
+	// quantized positions, half uvs and octahedral normals, 12 bytes per vertex without normals
+	static VertexLayout compressed(bool normals = false, VertexFormat positionFormat = VertexFormat::SNORM16x4)
+	{
+		VertexLayout layout;
+		layout.add(VertexSemantic::POSITION, positionFormat, 0);
+		layout.add(VertexSemantic::TEXCOORD, VertexFormat::HALF2, 1);
+		if (normals)
+			layout.add(VertexSemantic::NORMAL, VertexFormat::OCTAHEDRAL_SNORM16x2, NORMAL_LOCATION);
+		return layout;
+	}
+
+	GLsizei stride() const { return vertexStride; }
+	const std::vector<VertexAttribute> &attributes() const { return attributeList; }
+
+	const VertexAttribute *find(VertexSemantic semantic) const
+	{
+		for (const VertexAttribute &attribute : attributeList)
+		{
+			if (attribute.semantic == semantic)
+				return &attribute;
+		}
+		return NULL;
+	}
+
+	// point the attributes at the bound GL_ARRAY_BUFFER, the owning vertex array must be bound
+	void apply() const
+	{
+		for (const VertexAttribute &attribute : attributeList)
+		{
+			const void *offset = (const void *)(uintptr_t)attribute.offset;
+			switch (attribute.format)
+			{
+			case VertexFormat::FLOAT2:
+				glVertexAttribPointer(attribute.location, 2, GL_FLOAT, GL_FALSE, vertexStride, offset);
+				break;
+			case VertexFormat::FLOAT3:
+				glVertexAttribPointer(attribute.location, 3, GL_FLOAT, GL_FALSE, vertexStride, offset);
+				break;
+			case VertexFormat::HALF2:
+				glVertexAttribPointer(attribute.location, 2, GL_HALF_FLOAT, GL_FALSE, vertexStride, offset);
+				break;
+			case VertexFormat::SNORM16x4:
+				glVertexAttribPointer(attribute.location, 4, GL_SHORT, GL_TRUE, vertexStride, offset);
+				break;
+			case VertexFormat::SNORM_10_10_10_2:
+				glVertexAttribPointer(attribute.location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertexStride, offset);
+				break;
+			case VertexFormat::OCTAHEDRAL_SNORM16x2:
+				glVertexAttribPointer(attribute.location, 2, GL_SHORT, GL_TRUE, vertexStride, offset);
+				break;
+			}
+			glEnableVertexAttribArray(attribute.location);
+		}
+	}
+
+	// #defines selecting the matching decode paths in shader.vert
+	std::string shaderDefines() const
+	{
+		std::string defines;
+		const VertexAttribute *position = find(VertexSemantic::POSITION);
+		if (position && position->format != VertexFormat::FLOAT3)
+			defines += "#define POSITION_QUANTIZED\n";
+		const VertexAttribute *normal = find(VertexSemantic::NORMAL);
+		if (normal)
+		{
+			defines += "#define VERTEX_NORMAL\n";
+			if (normal->format == VertexFormat::OCTAHEDRAL_SNORM16x2)
+				defines += "#define NORMAL_OCTAHEDRAL\n";
+		}
+		return defines;
+	}
+
+	static GLsizei formatSize(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::FLOAT2:
+			return 8;
+		case VertexFormat::FLOAT3:
+			return 12;
+		case VertexFormat::SNORM16x4:
+			return 8;
+		default:
+			return 4; // HALF2, SNORM_10_10_10_2, OCTAHEDRAL_SNORM16x2
+		}
+	}
+
+	static const GLuint NORMAL_LOCATION = 6; // 2 holds the instance slot
+
+private:
+	std::vector<VertexAttribute> attributeList;
+	GLsizei vertexStride = 0;
+};
+
+// box quantized positions are normalized to, they decode as position * scale + offset
+struct PositionQuantization
+{
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// vertex data encoded for a layout, quantized positions decode as position * positionScale + positionOffset
+struct QuantizedVertices
+{
+	std::vector<unsigned char> data;
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+};
+
+// bounding box of every mesh, meshes drawn with the same uniforms have to share one
+inline PositionQuantization fitPositionQuantization(const std::vector<const MeshData *> &meshes)
+{
+	PositionQuantization quantization;
+	bool empty = true;
+	glm::vec3 lo(0.0f), hi(0.0f);
+	for (const MeshData *mesh : meshes)
+	{
+		for (size_t v = 0; v < mesh->vertexCount(); v++)
+		{
+			glm::vec3 p(mesh->vertices[v * mesh->stride], mesh->vertices[v * mesh->stride + 1], mesh->vertices[v * mesh->stride + 2]);
+			lo = empty ? p : glm::min(lo, p);
+			hi = empty ? p : glm::max(hi, p);
+			empty = false;
+		}
+	}
+	if (!empty)
+	{
+		quantization.offset = (lo + hi) * 0.5f;
+		quantization.scale = glm::max((hi - lo) * 0.5f, glm::vec3(1e-20f));
+	}
+	return quantization;
+}
+
+inline uint16_t packHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, 4);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // inf, nan
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7C00); // overflow to inf
+	if (exponent <= 0)
+	{
+		// denormal or zero
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			half++;
+		return (uint16_t)(sign | half);
+	}
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+		half++; // round, a carry into the exponent is still the right answer
+	return (uint16_t)half;
+}
+
+inline int16_t packSnorm16(float value)
+{
+	return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+// x, y, z in bits 0-29 as 10 bit snorm, w (2 bits) left at 0, matches GL_INT_2_10_10_10_REV
+inline uint32_t packSnorm10x3(const glm::vec3 &value)
+{
+	uint32_t packed = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int32_t component = (int32_t)std::lround(std::clamp(value[i], -1.0f, 1.0f) * 511.0f);
+		packed |= ((uint32_t)component & 0x3FF) << (i * 10);
+	}
+	return packed;
+}
+
+// project a unit vector onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+inline glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+	n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return e;
+}
+
+// encode a mesh into a layout. Source vertices are position xyz, uv, and a normal xyz when the mesh
+// stride is at least 8; a normal attribute without source normals gets +z. Quantized positions are
+// normalized to the given box, it has to contain the mesh.
+inline QuantizedVertices quantizeVertices(const MeshData &mesh, const VertexLayout &layout, const PositionQuantization &quantization)
+{
+	QuantizedVertices out;
+	const size_t vertexCount = mesh.vertexCount();
+	out.data.resize(vertexCount * layout.stride());
+
+	const VertexAttribute *position = layout.find(VertexSemantic::POSITION);
+	if (position && position->format != VertexFormat::FLOAT3)
+	{
+		out.positionOffset = quantization.offset;
+		out.positionScale = quantization.scale;
+	}
+
+	float maxPositionError = 0.0f;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		const float *source = &mesh.vertices[v * mesh.stride];
+		unsigned char *vertex = &out.data[v * layout.stride()];
+		for (const VertexAttribute &attribute : layout.attributes())
+		{
+			glm::vec3 value;
+			if (attribute.semantic == VertexSemantic::POSITION)
+				value = (glm::vec3(source[0], source[1], source[2]) - out.positionOffset) / out.positionScale;
+			else if (attribute.semantic == VertexSemantic::TEXCOORD)
+				value = glm::vec3(source[3], source[4], 0.0f);
+			else
+				value = mesh.stride >= 8 ? glm::normalize(glm::vec3(source[5], source[6], source[7])) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+			unsigned char *dst = vertex + attribute.offset;
+			switch (attribute.format)
+			{
+			case VertexFormat::FLOAT2:
+				std::memcpy(dst, &value[0], 8);
+				break;
+			case VertexFormat::FLOAT3:
+				std::memcpy(dst, &value[0], 12);
+				break;
+			case VertexFormat::HALF2:
+			{
+				uint16_t packed[2] = {packHalf(value.x), packHalf(value.y)};
+				std::memcpy(dst, packed, 4);
+				break;
+			}
+			case VertexFormat::SNORM16x4:
+			{
+				int16_t packed[4] = {packSnorm16(value.x), packSnorm16(value.y), packSnorm16(value.z), 0};
+				std::memcpy(dst, packed, 8);
+				if (attribute.semantic == VertexSemantic::POSITION)
+				{
+					glm::vec3 decoded = glm::vec3(packed[0], packed[1], packed[2]) / 32767.0f;
+					maxPositionError = std::max(maxPositionError, glm::length((decoded - value) * out.positionScale));
+				}
+				break;
+			}
+			case VertexFormat::SNORM_10_10_10_2:
+			{
+				uint32_t packed = packSnorm10x3(value);
+				std::memcpy(dst, &packed, 4);
+				if (attribute.semantic == VertexSemantic::POSITION)
+				{
+					glm::vec3 decoded(glm::round(glm::clamp(value, -1.0f, 1.0f) * 511.0f) / 511.0f);
+					maxPositionError = std::max(maxPositionError, glm::length((decoded - value) * out.positionScale));
+				}
+				break;
+			}
+			case VertexFormat::OCTAHEDRAL_SNORM16x2:
+			{
+				glm::vec2 encoded = encodeOctahedral(value);
+				int16_t packed[2] = {packSnorm16(encoded.x), packSnorm16(encoded.y)};
+				std::memcpy(dst, packed, 4);
+				break;
+			}
+			}
+		}
+	}
+
+	spdlog::info("Vertex layout: {} -> {} bytes per vertex, {} -> {} bytes, max position error {:.6f}",
+		mesh.stride * sizeof(float), layout.stride(), mesh.vertices.size() * sizeof(float), out.data.size(), maxPositionError);
+	return out;
+}
+
+// quantize against the mesh's own bounding box
+inline QuantizedVertices quantizeVertices(const MeshData &mesh, const VertexLayout &layout)
+{
+	return quantizeVertices(mesh, layout, fitPositionQuantization({&mesh}));
+}
+#endif // !VERTEX_LAYOUT_H
\ No newline at end of file
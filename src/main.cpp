@@ -2,7 +2,7 @@
 
 #include <glad/glad.h>	   // cross-platform opengl loader
 #include <GLFW/glfw3.h>	   // winapi window generator
-#include "spdlog/spdlog.h" // logger
+#include "Log.h"		   // async logger, goes before anything that includes spdlog
 
 // matrix/vector utilities
 #include <glm/glm.hpp>
@@ -12,6 +12,35 @@
 #include "Shader.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureAtlas.h"
+#include "InstanceBuffer.h"
+#include "Framebuffer.h"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
+#include "UniformRing.h"
+#include "GLState.h"
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "VertexLayout.h"
+#include "GeometryArena.h"
+#include "ShaderCompiler.h"
+#include "FileWatcher.h"
+#include "SimulationClock.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "TransformHierarchy.h"
+#include "TransformBatch.h"
+#include "JobSystem.h"
+
+#include <string>
+#include <memory>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
 
 #define DEFAULT_WINDOW_WIDTH 800
 #define DEFAULT_WINDOW_HEIGHT 600
@@ -23,6 +52,26 @@ void inputMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset
 
 void processInput(GLFWwindow *window);
 
+// command line options
+struct RunOptions
+{
+	bool headless = false;	// render offscreen through EGL instead of a GLFW window
+	int frames = 0;			// stop after this many frames, 0 runs until the window is closed
+	std::string dumpDir;	// write every frame as a PPM image into this directory
+	bool benchmark = false;	// deterministic scene and scripted camera, writes frame time percentiles
+	BenchmarkConfig bench;
+	std::vector<std::pair<std::string, std::string>> bake; // --bake IN OUT, texture baking runs without a GL context
+	std::string meshPath;	// .obj or .glb drawn instead of the built-in cube
+	std::string vertexFormat = "snorm16"; // --vertices float|snorm16|10_10_10_2, position storage format
+	double simRate = 60.0;	// fixed simulation steps per second, independent of the frame rate
+	int framesInFlight = 2;	// frames the CPU may run ahead of the GPU, 0 leaves it to the driver
+	int swapInterval = 1;	// vsync intervals per swap, 0 presents immediately
+	std::string tracePath;	// write a Chrome trace of the last profiled zones on exit
+	int benchTransforms = 0; // --bench-transforms N, time matrix composition for N objects and exit
+	int jobThreads = 0;		// job system workers, 0 uses every core but the render thread's
+};
+bool parseOptions(int argc, char **argv, RunOptions &options);
+
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = DEFAULT_WINDOW_WIDTH / 2.0f;
@@ -33,35 +82,80 @@ bool firstMouse = true;
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last 
 
-int main()
+// F9 writes a trace of the recent profiler zones
+bool traceRequested = false;
+
+int main(int argc, char **argv)
 {
-	// Initialize GLFW
-	spdlog::info("Initializing GLFW");
+	// everything logs through a background thread from here on
+	AsyncLogging asyncLogging;
+	LogRateLimiter::get().setLimit("input", 5.0, 10.0);
 
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	RunOptions options;
+	if (!parseOptions(argc, argv, options))
+		return -1;
+	PROFILE_THREAD_NAME("render");
 
-	// Main GLFW window object
-	auto window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "OpenGL window wow", NULL, NULL);
-	if (window == NULL)
+	// CPU only microbenchmark, exits without opening a window
+	if (options.benchTransforms > 0)
 	{
-		spdlog::critical("Failed to create GLFW window");
-		glfwTerminate();
-		return -1;
+		benchmarkTransformComposition(options.benchTransforms);
+		return 0;
+	}
+
+	// offline texture baking, exits without opening a window
+	if (!options.bake.empty())
+	{
+		bool baked = true;
+		for (auto &job : options.bake)
+			baked &= bakeTexture(job.first, job.second);
+		return baked ? 0 : -1;
+	}
+
+	if (options.benchmark && options.frames == 0)
+		options.frames = options.bench.warmup + options.bench.frames;
+
+	GLFWwindow *window = NULL;
+	HeadlessContext headless;
+	GLADloadproc loader;
+	if (options.headless)
+	{
+		spdlog::info("Initializing headless EGL context");
+		if (!headless.create(3, 3))
+			return -1;
+		loader = (GLADloadproc)HeadlessContext::getProcAddress;
+		if (options.frames == 0 && !options.benchmark)
+			options.frames = 1;
+	}
+	else
+	{
+		// Initialize GLFW
+		spdlog::info("Initializing GLFW");
+
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Main GLFW window object
+		window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "OpenGL window wow", NULL, NULL);
+		if (window == NULL)
+		{
+			spdlog::critical("Failed to create GLFW window");
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		loader = (GLADloadproc)glfwGetProcAddress;
 	}
-	glfwMakeContextCurrent(window);
 
 	// Initialize GLAD (system specific header loader)
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	if (!gladLoadGLLoader(loader))
 	{
 		spdlog::critical("Failed to initialize GLAD");
 		return -1;
 	}
-
-	// Compile shaders
-	Shader shader("src/shader.vert", "src/shader.frag");
+	ShaderCompiler::get().init(loader);
 
 	// Vertex data, buffers, attribues
 	float vertices[] = {
@@ -107,7 +201,7 @@ int main()
 		-0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
 		-0.5f, 0.5f, -0.5f, 0.0f, 1.0f};
 
-	glm::vec3 cubePositions[] = {
+	std::vector<glm::vec3> cubePositions = {
 		glm::vec3(0.0f, 0.0f, 0.0f),
 		glm::vec3(2.0f, 5.0f, -15.0f),
 		glm::vec3(-1.5f, -2.2f, -2.5f),
@@ -118,120 +212,602 @@ int main()
 		glm::vec3(1.5f, 2.0f, -2.5f),
 		glm::vec3(1.5f, 0.2f, -1.5f),
 		glm::vec3(-1.3f, 1.0f, -1.5f)};
+	float sceneRadius = 15.0f;
+	if (options.benchmark)
+	{
+		cubePositions = benchmarkCubePositions(options.bench.cubes);
+		sceneRadius = benchmarkSceneRadius(options.bench.cubes);
+	}
 
-	// Generate vertex buffer object
-	unsigned int VBO, VAO;
-	// unsigned int EBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	// glGenBuffers(1, &EBO);
+	// weld the cube into 24 unique vertices plus an index buffer, an imported model joins it in the scene
+	std::vector<MeshData> sceneMeshes;
+	sceneMeshes.push_back(buildIndexedMesh("cube", vertices, sizeof(vertices) / (5 * sizeof(float)), 5));
+	MeshLoader meshLoader;
+	MeshData imported;
+	if (!options.meshPath.empty() && meshLoader.load(options.meshPath, imported))
+	{
+		optimizeMesh(options.meshPath.c_str(), imported);
+		sceneMeshes.push_back(std::move(imported));
+	}
 
-	// Bind vertex array object, then bind vertex buffer(s) then configure attributes
-	glBindVertexArray(VAO);
+	// quantize into the vertex layout, shader.vert decodes it through the defines the layout emits
+	VertexLayout layout = VertexLayout::uncompressed();
+	if (options.vertexFormat == "snorm16")
+		layout = VertexLayout::compressed(false, VertexFormat::SNORM16x4);
+	else if (options.vertexFormat == "10_10_10_2")
+		layout = VertexLayout::compressed(false, VertexFormat::SNORM_10_10_10_2);
+
+	// every mesh lives in one shared vertex/index buffer pair behind one vertex array
+	std::vector<const MeshData *> quantized;
+	for (const MeshData &mesh : sceneMeshes)
+		quantized.push_back(&mesh);
+	GeometryArena geometry(layout, fitPositionQuantization(quantized));
+	for (const MeshData &mesh : sceneMeshes)
+		geometry.add(mesh);
+	GLState &glState = GLState::get();
+
+	// Compile shaders, every program is submitted before any of them is waited on
+	ShaderBatch shaders;
+	Shader &shader = shaders.add("src/shader.vert", "src/shader.frag", layout.shaderDefines());
+	shaders.finish();
+
+	// per-slot model matrices and atlas regions in buffer textures, the visible slot stream at location 2
+	InstanceBuffer instances(geometry.ID, 2, true);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	// // color attribute
+	// glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
+	// glEnableVertexAttribArray(1);
+
+	// frame work fans out over the job system, texture decodes run on it in the background
+	JobSystem jobs(options.jobThreads);
+	spdlog::info("Job system running {} worker threads", jobs.workerCount());
+
+	// every texture is packed into one atlas, decoding happens on job workers and regions show a
+	// placeholder until their upload lands. Benchmark texture slots repeat the two images but each slot
+	// loads into its own region, with a page per slot so none of them is left out.
+	TextureLoader textureLoader(jobs);
+	int textureCount = options.benchmark ? std::max(1, options.bench.textures) : 2;
+	TextureAtlas atlas(2048, std::max(2, options.benchmark ? textureCount : 2));
+	std::vector<int> textures;
+	for (int i = 0; i < textureCount; i++)
+	{
+		if (i % 2 == 0)
+			textures.push_back(textureLoader.load("assets/dog.jpeg", atlas, !options.benchmark));
+		else
+			textures.push_back(textureLoader.load("assets/dog_with_hat.png", atlas, !options.benchmark));
+	}
 
-	// glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	// glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	// a material blends two atlas regions, cube i uses material i % materials
+	struct Material
+	{
+		int region1, region2;
+	};
+	std::vector<Material> materials;
+	if (options.benchmark)
+	{
+		for (int i = 0; i < textureCount; i++)
+			materials.push_back({textures[i], textures[(i + 1) % textureCount]});
+	}
+	else
+	{
+		materials.push_back({textures[0], textures[1]});
+	}
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-	glEnableVertexAttribArray(0);
+	// cube i uses mesh (i / materials) % meshes, materials travel with the instance so instances are
+	// only grouped by mesh and the whole scene is one multi-draw with a command per mesh
+	const size_t meshCount = geometry.meshCount();
+	const size_t groupCount = meshCount;
+	std::vector<unsigned int> drawOrder;
+	std::vector<GLsizei> groupStart;
+	for (size_t g = 0; g < groupCount; g++)
+	{
+		groupStart.push_back((GLsizei)drawOrder.size());
+		for (size_t i = 0; i < cubePositions.size(); i++)
+		{
+			if ((i / materials.size()) % meshCount == g)
+				drawOrder.push_back((unsigned int)i);
+		}
+	}
+	groupStart.push_back((GLsizei)drawOrder.size());
 
-	// texture coord attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// bounding spheres in draw order, culling keeps the visible list grouped
+	BoundingSpheres cubeBounds;
+	for (size_t g = 0; g < groupCount; g++)
+	{
+		float radius = geometry.mesh((int)g).radius; // sphere around the mesh origin covers any rotation
+		for (GLsizei slot = groupStart[g]; slot < groupStart[g + 1]; slot++)
+			cubeBounds.add(cubePositions[drawOrder[slot]], radius);
+	}
+	std::vector<GeometryArena::DrawCommand> drawCommands;
+
+	// culling runs in chunks on the job system, each chunk keeps its own visible list
+	const size_t CULL_GRAIN = 4096;
+	size_t cullChunks = (cubeBounds.size() + CULL_GRAIN - 1) / CULL_GRAIN;
+	std::vector<std::vector<uint32_t>> chunkVisible(cullChunks);
+	std::vector<uint32_t> visibleSlots;
+
+	// every cube is a static placement node with a spin node below it. Spin nodes are added last in draw
+	// order, so instance slot s is node firstInstanceNode + s and changed world matrices map straight onto
+	// the persistent instance buffer. Only animated cubes ever touch their spin node.
+	const glm::vec3 TILT_AXIS = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+	TransformHierarchy transforms;
+	transforms.reserve(cubePositions.size() * 2);
+	std::vector<uint32_t> placementNodes(cubePositions.size());
+	for (size_t i = 0; i < cubePositions.size(); i++)
+	{
+		glm::mat4 placement = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+		placement = glm::rotate(placement, glm::radians(20.0f * i), TILT_AXIS);
+		placementNodes[i] = transforms.add(placement);
+	}
+	const uint32_t firstInstanceNode = (uint32_t)transforms.size();
+	for (unsigned int i : drawOrder)
+		transforms.add(glm::mat4(1.0f), placementNodes[i]);
+	if (!instances.allocate(drawOrder.size()))
+	{
+		spdlog::critical("Too many cubes for the instance buffers, lower --cubes");
+		return -1;
+	}
 
-	// // color attribute
-	// glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-	// glEnableVertexAttribArray(1);
+	// benchmark scenes can leave most cubes static, the animated ones are spread evenly over the scene
+	std::vector<uint32_t> animatedSlots;
+	float animatedFraction = options.benchmark ? std::min(1.0f, std::max(0.0f, options.bench.animated)) : 1.0f;
+	for (size_t s = 0; s < drawOrder.size(); s++)
+	{
+		size_t i = drawOrder[s];
+		if (std::floor((i + 1) * animatedFraction) > std::floor(i * animatedFraction))
+			animatedSlots.push_back((uint32_t)s);
+	}
+	const glm::vec3 SPIN_AXIS = glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f));
+
+	// placement is translate * tilt, so a spin node's world matrix is the cube position with the rotation
+	// tilt * spin. The batch builds those directly and the hierarchy takes them through setWorld().
+	const size_t TRANSFORM_GRAIN = 2048;
+	TransformArrays animatedTransforms;
+	animatedTransforms.resize(animatedSlots.size());
+	std::vector<glm::quat> animatedTilts(animatedSlots.size());
+	for (size_t a = 0; a < animatedSlots.size(); a++)
+	{
+		unsigned int i = drawOrder[animatedSlots[a]];
+		animatedTilts[a] = glm::angleAxis(glm::radians(20.0f * i), TILT_AXIS);
+		animatedTransforms.set(a, cubePositions[i], animatedTilts[a]);
+	}
+	std::vector<glm::mat4> animatedWorlds(animatedSlots.size());
 
-	// load and create textures
-	Texture tex1("assets/dog.jpeg", GL_RGB);
-	Texture tex2("assets/dog_with_hat.png", GL_RGBA);
+	// atlas regions per slot, rewritten only when a texture upload moved a region
+	std::vector<InstanceMaterial> instanceMaterials(drawOrder.size());
+	bool materialsDirty = true;
 
-	// assign textures to uniforms
+	// assign the atlas to its sampler
 	shader.use();
-	shader.setInt("texture1", 0);
-	shader.setInt("texture2", 1);
+	shader.setInt("atlas", 0);
+	shader.setInt("instanceMatrices", 1);
+	shader.setInt("instanceMaterials", 2);
+	shader.setVec3("positionScale", geometry.quantization().scale);
+	shader.setVec3("positionOffset", geometry.quantization().offset);
+
+	// per-frame uniforms live in a std140 block fed from a ring buffer, layout matches FrameData in the shaders
+	struct FrameUniforms
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		float blend_amount;
+		float padding[3];
+	};
+	const GLuint FRAME_DATA_BINDING = 0;
+	shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+	UniformRing uniformRing;
+
+	glState.viewport(0, 0, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+	if (window)
+	{
+		glfwSetFramebufferSizeCallback(window, framebufferSizeCallback); // resize viewport on window resize
+		glfwSetKeyCallback(window, inputKeyCallback);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // capture mouse cursor
+		glfwSetCursorPosCallback(window, inputMouseCallback);
+		glfwSetScrollCallback(window, inputMouseScrollCallback);
+	}
 
-	glViewport(0, 0, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
-	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback); // resize viewport on window resize
-	glfwSetKeyCallback(window, inputKeyCallback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // capture mouse cursor
-	glfwSetCursorPosCallback(window, inputMouseCallback);
-	glfwSetScrollCallback(window, inputMouseScrollCallback);
+	// headless runs have no default framebuffer to draw into
+	std::unique_ptr<Framebuffer> offscreen;
+	if (options.headless)
+	{
+		offscreen = std::make_unique<Framebuffer>(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+		offscreen->bind();
+		if (!options.dumpDir.empty())
+			std::filesystem::create_directories(options.dumpDir);
+	}
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // wireframe
 
-	glEnable(GL_DEPTH_TEST); // enable depth testing
+	glState.setEnabled(GL_DEPTH_TEST, true); // enable depth testing
+
+	// fixed clock runs must render identical frames, so they wait for every texture up front
+	if (options.headless || options.benchmark)
+		textureLoader.finishAll();
+
+	// benchmark timing, vsync off so frame times are not quantized to the refresh rate
+	std::unique_ptr<GpuFrameTimer> gpuTimer;
+	BenchmarkRecorder recorder;
+	FramePacer framePacer(options.framesInFlight);
+	GpuProfiler gpuProfiler;
+	if (window)
+		glfwSwapInterval(options.benchmark ? 0 : options.swapInterval);
+	if (options.benchmark)
+	{
+		gpuTimer = std::make_unique<GpuFrameTimer>();
+		spdlog::info("Benchmark: {} cubes, {} textures, {} + {} frames", cubePositions.size(), textureCount, options.bench.warmup, options.frames - options.bench.warmup);
+	}
+	float farPlane = std::max(100.0f, sceneRadius * 3.0f);
+
+	// interactive runs pick up shader edits, the old program keeps drawing until the new one links
+	std::unique_ptr<FileWatcher> shaderWatcher;
+	if (window && !options.benchmark)
+	{
+		shaderWatcher = std::make_unique<FileWatcher>();
+		shaderWatcher->watch("src/shader.vert");
+		shaderWatcher->watch("src/shader.frag");
+	}
+
+	// the scene is simulated at a fixed rate, rendering interpolates between the last two states
+	struct SceneState
+	{
+		double time = 0.0;
+		std::vector<float> spin; // per cube angle about the animated axis, radians
+	};
+	const float SPIN_RATE = glm::radians(50.0f);
+	const float TWO_PI = glm::radians(360.0f);
+	SimulationClock simulation(1.0 / options.simRate);
+	SceneState previousState, currentState;
+	currentState.spin.assign(cubePositions.size(), 0.0f);
+	previousState = currentState;
 
 	// Render loop
 	spdlog::info("Init success, entering render loop");
-	while (!glfwWindowShouldClose(window)) // check if window should still be open
+	int frameIndex = 0;
+	while (options.headless || !glfwWindowShouldClose(window)) // check if window should still be open
 	{
-		// Input
-		float currentFrame = glfwGetTime();
+		if (options.frames > 0 && frameIndex >= options.frames)
+			break;
+
+		PROFILE_ZONE("Frame");
+
+		// don't run ahead of the GPU, a queued frame would show input that is already stale
+		{
+			PROFILE_ZONE("Wait for GPU");
+			framePacer.throttle();
+		}
+
+		auto frameStart = std::chrono::steady_clock::now();
+		bool measured = options.benchmark && frameIndex >= options.bench.warmup;
+		renderStats.reset();
+		glState.resetCounters();
+		if (gpuTimer)
+			gpuTimer->begin();
+		gpuProfiler.beginFrame(measured);
+		gpuProfiler.begin("Frame");
+
+		// One time sample per frame. Headless and benchmark runs advance a fixed 60 Hz clock so output is reproducible
+		bool fixedClock = options.headless || options.benchmark;
+		double now = fixedClock ? frameIndex / 60.0 : glfwGetTime();
+		float currentFrame = (float)now;
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
-		processInput(window);
-		float timeValue = (float)glfwGetTime();
+
+		// Simulate, as many fixed steps as the frame time covers
+		int steps = simulation.advance(now);
+		for (int step = 0; step < steps; step++)
+		{
+			PROFILE_ZONE("Simulate step");
+			std::swap(previousState, currentState);
+			currentState.time = previousState.time + simulation.step();
+			currentState.spin.resize(previousState.spin.size());
+			for (uint32_t slot : animatedSlots)
+			{
+				unsigned int i = drawOrder[slot];
+				currentState.spin[i] = previousState.spin[i] + SPIN_RATE * (float)simulation.step();
+				// wrap both states together so interpolation never crosses the wrap
+				if (currentState.spin[i] > TWO_PI)
+				{
+					currentState.spin[i] -= TWO_PI;
+					previousState.spin[i] -= TWO_PI;
+				}
+			}
+		}
+		float alpha = simulation.alpha();
+		float timeValue = (float)(previousState.time + (currentState.time - previousState.time) * alpha);
+
+		if (shaderWatcher)
+		{
+			PROFILE_ZONE("Shader hot reload");
+			std::vector<std::string> changed = shaderWatcher->poll();
+			for (Shader &program : shaders)
+			{
+				bool issued = false;
+				for (const std::string &path : changed)
+				{
+					if (program.usesFile(path))
+					{
+						issued = program.reload();
+						break;
+					}
+				}
+				// without parallel compile the status query blocks, give the driver this frame first
+				if (!issued)
+					program.pollReload();
+			}
+		}
+
+		// finished texture decodes, a few per frame so uploads never cause a hitch
+		if (textureLoader.pumpUploads() > 0)
+			materialsDirty = true;
 
 		// Render
-		glClearColor(sin(-timeValue * 2.0f) / 2.0f + 0.2f, sin(-timeValue * 0.5f) / 2.0f + 0.3f, sin(-timeValue * 3.0f) / 2.0f + 0.5f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// Bind textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, tex1.ID);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, tex2.ID);
+		{
+			GPU_ZONE(gpuProfiler, "Clear");
+			glClearColor(sin(-timeValue * 2.0f) / 2.0f + 0.2f, sin(-timeValue * 0.5f) / 2.0f + 0.3f, sin(-timeValue * 3.0f) / 2.0f + 0.5f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
 		shader.use();
-		shader.setFloat("blend_amount", sin(timeValue));
 
-		glm::mat4 trans = glm::mat4(1.0f); // init matrix to identity matrix
-		glm::mat4 model = glm::mat4(1.0f); // init projection matrix
-		model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+		// Input, sampled as late as possible: everything above does not depend on the camera
+		{
+			PROFILE_ZONE("Input");
+			if (options.benchmark)
+				benchmarkCameraPath(camera, frameIndex, sceneRadius);
+			else if (window)
+			{
+				glfwPollEvents();
+				processInput(window);
+			}
+			framePacer.markInput(measured);
+		}
 
-		const float radius = 10.0f;
-		float camX = sin(glfwGetTime()) * radius;
-		float camZ = cos(glfwGetTime()) * radius;
-		
+		const float aspect = (float)DEFAULT_WINDOW_WIDTH / (float)DEFAULT_WINDOW_WIDTH;
 		auto view = camera.GetViewMatrix();
-		auto projection = glm::perspective(glm::radians(camera.Zoom), (float)DEFAULT_WINDOW_WIDTH / (float)DEFAULT_WINDOW_WIDTH, 0.1f, 100.0f);
+		auto projection = camera.GetProjectionMatrix(aspect, 0.1f, farPlane);
 
 		// set shader uniforms
-		shader.setMat4("model", model);
-		shader.setMat4("view", view);
-		shader.setMat4("projection", projection);
+		FrameUniforms frameUniforms;
+		frameUniforms.view = view;
+		frameUniforms.projection = projection;
+		frameUniforms.blend_amount = sin(timeValue);
+		uniformRing.beginFrame();
+		UniformRing::Allocation frameData = uniformRing.push(frameUniforms);
+		uniformRing.flush();
+		uniformRing.bind(FRAME_DATA_BINDING, frameData);
+
+		// frustum cull, instances stay in their slots and the visible ones are compacted into the slot
+		// stream. Chunks are joined in order so the stream stays grouped by mesh, and every mesh is one
+		// indirect command whose base instance is where its group starts in the stream.
+		{
+			PROFILE_ZONE("Cull");
+			Frustum frustum = camera.GetFrustum(aspect, 0.1f, farPlane);
+			jobs.parallelFor(cubeBounds.size(), CULL_GRAIN, [&](size_t begin, size_t end) {
+				PROFILE_ZONE("Cull chunk");
+				cullSpheres(frustum, cubeBounds, chunkVisible[begin / CULL_GRAIN], begin, end);
+			});
+			visibleSlots.clear();
+			for (const std::vector<uint32_t> &visible : chunkVisible)
+				visibleSlots.insert(visibleSlots.end(), visible.begin(), visible.end());
+
+			drawCommands.clear();
+			std::vector<uint32_t>::const_iterator groupBegin = visibleSlots.begin();
+			for (size_t g = 0; g < groupCount; g++)
+			{
+				std::vector<uint32_t>::const_iterator groupEnd = std::lower_bound(groupBegin, visibleSlots.cend(), (uint32_t)groupStart[g + 1]);
+				if (groupEnd != groupBegin)
+				{
+					const GeometryArena::MeshRange &mesh = geometry.mesh((int)g);
+					drawCommands.push_back({(GLuint)mesh.indexCount, (GLuint)(groupEnd - groupBegin), mesh.firstIndex, mesh.baseVertex,
+						(GLuint)(groupBegin - visibleSlots.cbegin())});
+				}
+				groupBegin = groupEnd;
+			}
+		}
 
-		// render container
-		glBindVertexArray(VAO);
-		for (unsigned int i = 0; i < 10; i++)
+		// move the animated spin nodes, then send only the world matrices that changed. Regions are
+		// rewritten when an upload moved one off the placeholder.
 		{
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
-			shader.setMat4("model", model);
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			PROFILE_ZONE("Update transforms");
+			jobs.parallelFor(animatedSlots.size(), TRANSFORM_GRAIN, [&](size_t begin, size_t end) {
+				PROFILE_ZONE("Compose spin chunk");
+				for (size_t a = begin; a < end; a++)
+				{
+					unsigned int i = drawOrder[animatedSlots[a]];
+					float spin = previousState.spin[i] + (currentState.spin[i] - previousState.spin[i]) * alpha;
+					animatedTransforms.setRotation(a, animatedTilts[a] * glm::angleAxis(spin, SPIN_AXIS));
+				}
+				composeTransforms(animatedTransforms, begin, end, animatedWorlds.data());
+			});
+			for (size_t a = 0; a < animatedSlots.size(); a++)
+				transforms.setWorld(firstInstanceNode + animatedSlots[a], animatedWorlds[a]);
+			const std::vector<uint32_t> &changed = transforms.update();
+			for (size_t c = 0; c < changed.size();)
+			{
+				if (changed[c] < firstInstanceNode)
+				{
+					c++;
+					continue;
+				}
+				size_t run = c + 1;
+				while (run < changed.size() && changed[run] == changed[run - 1] + 1)
+					run++;
+				instances.update(changed[c] - firstInstanceNode, &transforms.world(changed[c]), run - c);
+				renderStats.matricesUploaded += (uint32_t)(run - c);
+				c = run;
+			}
+
+			if (materialsDirty)
+			{
+				for (size_t s = 0; s < drawOrder.size(); s++)
+				{
+					const Material &material = materials[drawOrder[s] % materials.size()];
+					const AtlasRegion &region1 = atlas.region(material.region1);
+					const AtlasRegion &region2 = atlas.region(material.region2);
+					instanceMaterials[s].region1 = glm::vec4(region1.scale, region1.offset);
+					instanceMaterials[s].region2 = glm::vec4(region2.scale, region2.offset);
+					instanceMaterials[s].layers = glm::vec4(region1.layer, region2.layer, 0.0f, 0.0f);
+				}
+				instances.updateMaterials(0, instanceMaterials.data(), instanceMaterials.size());
+				materialsDirty = false;
+			}
+		}
+
+		// render containers, a single multi-draw reading the atlas and the instance slot buffers
+		{
+			PROFILE_ZONE("Submit draws");
+			GPU_ZONE(gpuProfiler, "Cubes");
+			geometry.bind();
+			geometry.uploadCommands(drawCommands);
+			instances.uploadIndices(visibleSlots);
+			glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, atlas.ID);
+			instances.bindTextures(1, 2);
+			renderStats.drawCalls += geometry.multiDraw(0, drawCommands.size(), instances);
 		}
 		// glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		uniformRing.endFrame();
+		gpuProfiler.end();
+		if (gpuTimer)
+			gpuTimer->end(measured);
 
-		// Poll events and swap buffers
-		glfwPollEvents();
-		glfwSwapBuffers(window);
+		if (offscreen && !options.dumpDir.empty())
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "/frame_%05d.ppm", frameIndex);
+			offscreen->writePPM(options.dumpDir + name);
+		}
+
+		// Swap buffers, events were polled before the camera was updated
+		if (window)
+		{
+			PROFILE_ZONE("Swap buffers");
+			glfwSwapBuffers(window);
+		}
+		framePacer.endFrame();
+		gpuProfiler.endFrame();
+
+		renderStats.stateChanges = glState.counters().issued;
+		renderStats.stateChangesSkipped = glState.counters().skipped;
+		if (measured)
+			recorder.addFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count(), renderStats);
+		frameIndex++;
+
+		if (traceRequested)
+		{
+			traceRequested = false;
+			Profiler::get().writeChromeTrace("trace_" + std::to_string(frameIndex) + ".json");
+		}
 	}
 
-	glfwTerminate();
+	spdlog::info("Rendered {} frames", frameIndex);
+	framePacer.flush();
+	gpuProfiler.collect(true);
+	for (const auto &pass : gpuProfiler.samplesMs)
+		spdlog::info("GPU pass {}: p50 {:.3f} ms p95 {:.3f} ms", pass.first, BenchmarkRecorder::percentile(pass.second, 50), BenchmarkRecorder::percentile(pass.second, 95));
+	if (gpuProfiler.dropped > 0)
+		spdlog::warn("GPU profiler dropped {} frames whose queries were not ready in time", gpuProfiler.dropped);
+	if (!framePacer.latencyMs.empty())
+		spdlog::info("Input to present latency: p50 {:.2f} ms p95 {:.2f} ms ({} frames in flight)", BenchmarkRecorder::percentile(framePacer.latencyMs, 50),
+			BenchmarkRecorder::percentile(framePacer.latencyMs, 95), framePacer.maxFramesInFlight());
+	if (gpuTimer)
+	{
+		gpuTimer->flush();
+		recorder.writeJson(options.bench.outputPath, options.bench, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, gpuTimer->samplesMs, framePacer.latencyMs, gpuProfiler.samplesMs);
+		gpuTimer.reset();
+	}
+
+	if (!options.tracePath.empty())
+		Profiler::get().writeChromeTrace(options.tracePath);
+
+	offscreen.reset();
+	if (window)
+		glfwTerminate();
 	return 0;
 }
 
+// --headless, --frames N, --dump DIR, --benchmark [--cubes N] [--textures M] [--warmup N] [--animated F] [--json PATH], --mesh PATH, --vertices FORMAT, --sim-rate HZ, --frames-in-flight N, --swap-interval N, --trace PATH, --jobs N, --bench-transforms N, --bake IN OUT
+bool parseOptions(int argc, char **argv, RunOptions &options)
+{
+	auto printUsage = [argv]() {
+		spdlog::info("Usage: {} [--headless] [--frames N] [--dump DIR] [--benchmark [--cubes N] [--textures M] [--warmup N] [--animated F] [--json PATH]] [--mesh PATH] [--vertices float|snorm16|10_10_10_2] [--sim-rate HZ] [--frames-in-flight N] [--swap-interval N] [--trace PATH] [--jobs N] [--bench-transforms N] [--bake IN OUT]...", argv[0]);
+	};
+
+	bool framesSet = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--headless")
+			options.headless = true;
+		else if (arg == "--frames" && hasValue)
+		{
+			options.frames = std::atoi(argv[++i]);
+			framesSet = true;
+		}
+		else if (arg == "--dump" && hasValue)
+			options.dumpDir = argv[++i];
+		else if (arg == "--benchmark")
+			options.benchmark = true;
+		else if (arg == "--cubes" && hasValue)
+			options.bench.cubes = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--textures" && hasValue)
+			options.bench.textures = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--warmup" && hasValue)
+			options.bench.warmup = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--animated" && hasValue)
+			options.bench.animated = (float)std::atof(argv[++i]);
+		else if (arg == "--json" && hasValue)
+			options.bench.outputPath = argv[++i];
+		else if (arg == "--mesh" && hasValue)
+			options.meshPath = argv[++i];
+		else if (arg == "--vertices" && hasValue)
+		{
+			options.vertexFormat = argv[++i];
+			if (options.vertexFormat != "float" && options.vertexFormat != "snorm16" && options.vertexFormat != "10_10_10_2")
+			{
+				spdlog::critical("Unknown vertex format: {}", options.vertexFormat);
+				printUsage();
+				return false;
+			}
+		}
+		else if (arg == "--sim-rate" && hasValue)
+			options.simRate = std::max(1.0, std::atof(argv[++i]));
+		else if (arg == "--frames-in-flight" && hasValue)
+			options.framesInFlight = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--swap-interval" && hasValue)
+			options.swapInterval = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--trace" && hasValue)
+			options.tracePath = argv[++i];
+		else if (arg == "--jobs" && hasValue)
+			options.jobThreads = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--bench-transforms" && hasValue)
+			options.benchTransforms = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--bake" && i + 2 < argc)
+		{
+			options.bake.push_back({argv[i + 1], argv[i + 2]});
+			i += 2;
+		}
+		else
+		{
+			spdlog::critical("Unknown argument: {}", arg);
+			printUsage();
+			return false;
+		}
+	}
+
+	// in benchmark mode --frames counts measured frames, warmup comes on top
+	if (options.benchmark && framesSet)
+	{
+		options.bench.frames = options.frames;
+		options.frames = 0;
+	}
+	return true;
+}
+
 void processInput(GLFWwindow *window)
 {
+	PROFILE_FUNCTION();
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		spdlog::info("Exiting application from user input");
@@ -251,20 +827,24 @@ void processInput(GLFWwindow *window)
 // Resize viewport on window size change
 void framebufferSizeCallback(GLFWwindow *window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 }
 
 void inputKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+		traceRequested = true;
+
+	// key repeat floods this, so it is debug only and rate limited
 	auto key_name = glfwGetKeyName(key, scancode);
-	const char *action_name[3] = {"PRESS", "RELEASE", "REPEAT"};
+	[[maybe_unused]] const char *action_name[3] = {"PRESS", "RELEASE", "REPEAT"};
 	if (key_name)
 	{
-		spdlog::info("Input key event: {} {}", key_name, action_name[action]);
+		LOG_LIMITED_DEBUG("input", "Input key event: {} {}", key_name, action_name[action]);
 	}
 	else
 	{
-		spdlog::info("Input key event: {} {}", key, action_name[action]);
+		LOG_LIMITED_DEBUG("input", "Input key event: {} {}", key, action_name[action]);
 	}
 }
 
@@ -3,13 +3,29 @@ out vec4 FragColor;
   
 in vec3 v3_color;
 in vec2 v2_tex_coord;
+flat in vec4 v4_region1;
+flat in vec4 v4_region2;
+flat in vec2 v2_layers;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
-uniform float blend_amount;
+// every texture lives in a region of one atlas page
+uniform sampler2DArray atlas;
 
+// per-frame data, filled from the uniform ring buffer
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    float blend_amount;
+};
+
+// repeat inside the region, gradients of the unwrapped coordinate keep fract() from picking a tiny mip at the seam
+vec4 sampleRegion(vec4 region, float layer)
+{
+    vec2 uv = fract(v2_tex_coord) * region.xy + region.zw;
+    return textureGrad(atlas, vec3(uv, layer), dFdx(v2_tex_coord) * region.xy, dFdy(v2_tex_coord) * region.xy);
+}
 
 void main()
 {
-    FragColor = mix(texture(texture1, v2_tex_coord), texture(texture2, v2_tex_coord), blend_amount);
+    FragColor = mix(sampleRegion(v4_region1, v2_layers.x), sampleRegion(v4_region2, v2_layers.y), blend_amount);
 }
\ No newline at end of file
@@ -1,15 +1,69 @@
 #version 410 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in uint aInstance; // per-instance slot, indexes the buffers below
+#ifdef VERTEX_NORMAL
+layout (location = 6) in vec4 aNormal;
+out vec3 v3_normal;
+#endif
 
 out vec2 v2_tex_coord;
+flat out vec4 v4_region1;
+flat out vec4 v4_region2;
+flat out vec2 v2_layers;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-slot model matrices, four texels each, and atlas regions (uv scale in xy and offset in zw) plus
+// their layers, three texels each
+uniform samplerBuffer instanceMatrices;
+uniform samplerBuffer instanceMaterials;
+
+// per-frame data, filled from the uniform ring buffer
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    float blend_amount;
+};
+
+#ifdef POSITION_QUANTIZED
+// normalized positions span the mesh bounding box
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+#endif
+
+#ifdef NORMAL_OCTAHEDRAL
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return normalize(n);
+}
+#endif
 
 void main()
 {
-    gl_Position = projection *  view * model * vec4(aPos, 1.0f);
+#ifdef POSITION_QUANTIZED
+    vec3 position = aPos.xyz * positionScale + positionOffset;
+#else
+    vec3 position = aPos.xyz;
+#endif
+    int matrix = int(aInstance) * 4;
+    mat4 model = mat4(texelFetch(instanceMatrices, matrix), texelFetch(instanceMatrices, matrix + 1),
+                      texelFetch(instanceMatrices, matrix + 2), texelFetch(instanceMatrices, matrix + 3));
+    gl_Position = projection *  view * model * vec4(position, 1.0f);
     v2_tex_coord = aTexCoord;
+    int material = int(aInstance) * 3;
+    v4_region1 = texelFetch(instanceMaterials, material);
+    v4_region2 = texelFetch(instanceMaterials, material + 1);
+    v2_layers = texelFetch(instanceMaterials, material + 2).xy;
+
+#ifdef VERTEX_NORMAL
+#ifdef NORMAL_OCTAHEDRAL
+    vec3 normal = decodeOctahedral(aNormal.xy);
+#else
+    vec3 normal = aNormal.xyz;
+#endif
+    v3_normal = mat3(model) * normal;
+#endif
 }
\ No newline at end of file